@@ -0,0 +1,102 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QPainter>
+#include <QPaintEvent>
+
+#include <algorithm>
+
+#include "bootchart.h"
+
+BootChart::BootChart(QWidget *parent)
+ : QWidget(parent)
+{
+  setBackgroundRole(QPalette::Base);
+  setAutoFillBackground(true);
+}
+
+static bool barStartsBefore(const BootChart::Bar &a, const BootChart::Bar &b)
+{
+  return a.activating < b.activating;
+}
+
+void BootChart::setBars(const QList<Bar> &newBars, quint64 newUserspace, quint64 newFinish)
+{
+  bars = newBars;
+  std::sort(bars.begin(), bars.end(), barStartsBefore);
+  userspace = newUserspace;
+  finish = newFinish;
+  foreach (const Bar &bar, bars)
+    finish = qMax(finish, bar.activated);
+
+  setMinimumHeight((bars.size() + 1) * rowHeight);
+  updateGeometry();
+  update();
+}
+
+QSize BootChart::sizeHint() const
+{
+  return QSize(labelWidth + 600, (bars.size() + 1) * rowHeight);
+}
+
+void BootChart::paintEvent(QPaintEvent *event)
+{
+  QPainter painter(this);
+  if (bars.isEmpty() || finish == 0)
+    return;
+
+  int chartWidth = qMax(100, width() - labelWidth - 10);
+  double scale = double(chartWidth) / finish;
+
+  // Second marks and the start of userspace
+  painter.setPen(palette().color(QPalette::Mid));
+  quint64 step = finish > 60000000 ? 10000000 : (finish > 10000000 ? 5000000 : 1000000);
+  for (quint64 t = 0; t <= finish; t += step)
+  {
+    int x = labelWidth + int(t * scale);
+    painter.drawLine(x, event->rect().top(), x, event->rect().bottom());
+    painter.drawText(x + 2, rowHeight - 4, QString("%1 s").arg(t / 1000000));
+  }
+  if (userspace > 0)
+  {
+    painter.setPen(QPen(palette().color(QPalette::Highlight), 1, Qt::DashLine));
+    int x = labelWidth + int(userspace * scale);
+    painter.drawLine(x, event->rect().top(), x, event->rect().bottom());
+  }
+
+  // Only the exposed rows, the first row holds the time axis
+  int first = qMax(0, event->rect().top() / rowHeight - 1);
+  int last = qMin(bars.size() - 1, event->rect().bottom() / rowHeight);
+  QColor activating(200, 0, 0, 160), active(0, 128, 0, 40);
+  for (int i = first; i <= last; ++i)
+  {
+    const Bar &bar = bars.at(i);
+    int y = (i + 1) * rowHeight;
+    int x1 = labelWidth + int(bar.activating * scale);
+    int x2 = labelWidth + int((bar.activated ? bar.activated : finish) * scale);
+
+    painter.fillRect(x1, y + 3, qMax(1, x2 - x1), rowHeight - 6, activating);
+    painter.fillRect(x2, y + 3, labelWidth + chartWidth - x2, rowHeight - 6, active);
+
+    painter.setPen(palette().color(QPalette::Text));
+    QString label = bar.unit;
+    if (bar.activated > bar.activating)
+      label += QString(" (%1 ms)").arg((bar.activated - bar.activating) / 1000);
+    painter.drawText(QRect(2, y, labelWidth - 4, rowHeight), Qt::AlignVCenter | Qt::AlignRight,
+                     painter.fontMetrics().elidedText(label, Qt::ElideMiddle, labelWidth - 4));
+  }
+}
@@ -0,0 +1,49 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef BOOTCHART_H
+#define BOOTCHART_H
+
+#include <QWidget>
+
+// A time-scaled chart of unit activations during boot, one row per unit in
+// the order the units started activating. Only the rows in the exposed
+// area are painted, so it is meant to be placed in a scroll area.
+class BootChart : public QWidget
+{
+  Q_OBJECT
+
+public:
+  struct Bar
+  {
+    QString unit;
+    quint64 activating, activated;
+  };
+  BootChart(QWidget *parent = 0);
+  void setBars(const QList<Bar> &bars, quint64 userspace, quint64 finish);
+  QSize sizeHint() const;
+
+protected:
+  void paintEvent(QPaintEvent *event);
+
+private:
+  QList<Bar> bars;
+  quint64 userspace = 0, finish = 0;
+  static const int rowHeight = 18, labelWidth = 220;
+};
+
+#endif // BOOTCHART_H
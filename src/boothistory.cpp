@@ -0,0 +1,275 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QPointer>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <systemd/sd-journal.h>
+#include <systemd/sd-id128.h>
+
+#include <algorithm>
+
+#include "boothistory.h"
+
+// Journal message ids of the unit "Starting" and "Started" records
+static const char *idUnitStarting = "7d4958e842da4a758f6c1cdc7b36dcc5";
+static const char *idUnitStarted = "39f53479d3a045ac8e11786248231fbf";
+
+static QString journalField(sd_journal *journal, const char *field)
+{
+  const void *data;
+  size_t length;
+  if (sd_journal_get_data(journal, field, &data, &length) < 0)
+    return QString();
+  return QString::fromUtf8((const char *)data, length).section('=', 1);
+}
+
+// Lists the boot ids in the journal
+class ListBootsTask : public QRunnable
+{
+public:
+  ListBootsTask(BootHistory *history) : history(history) {}
+
+  void run()
+  {
+    QStringList bootIds;
+    sd_journal *journal;
+    if (sd_journal_open(&journal, SD_JOURNAL_LOCAL_ONLY | SD_JOURNAL_SYSTEM) == 0)
+    {
+      const void *data;
+      size_t length;
+      if (sd_journal_query_unique(journal, "_BOOT_ID") >= 0)
+      {
+        SD_JOURNAL_FOREACH_UNIQUE(journal, data, length)
+          bootIds << QString::fromLatin1((const char *)data, length).section('=', 1);
+      }
+      sd_journal_close(journal);
+    }
+    else
+      qDebug() << "Failed to open journal";
+
+    QString current;
+    sd_id128_t boot;
+    char id[33];
+    if (sd_id128_get_boot(&boot) == 0)
+      current = QString::fromLatin1(sd_id128_to_string(boot, id));
+
+    if (history)
+      QMetaObject::invokeMethod(history, "slotBootsListed", Qt::QueuedConnection,
+                                Q_ARG(QStringList, bootIds), Q_ARG(QString, current));
+  }
+
+private:
+  QPointer<BootHistory> history;
+};
+
+// Reads the unit start records of one boot
+class BootScanTask : public QRunnable
+{
+public:
+  BootScanTask(BootHistory *history, const QString &bootId) : history(history), bootId(bootId) {}
+
+  void run()
+  {
+    BootRecord record;
+    record.bootId = bootId;
+
+    sd_journal *journal;
+    if (sd_journal_open(&journal, SD_JOURNAL_LOCAL_ONLY | SD_JOURNAL_SYSTEM) == 0)
+    {
+      // Matches on different fields are ANDed, on the same field ORed
+      sd_journal_add_match(journal, QString("_BOOT_ID=" + bootId).toLatin1(), 0);
+      sd_journal_add_match(journal, QString("MESSAGE_ID=%1").arg(idUnitStarting).toLatin1(), 0);
+      sd_journal_add_match(journal, QString("MESSAGE_ID=%1").arg(idUnitStarted).toLatin1(), 0);
+
+      QHash<QString, quint64> starting;
+      SD_JOURNAL_FOREACH(journal)
+      {
+        uint64_t monotonic, realtime;
+        sd_id128_t entryBoot;
+        if (record.started == 0 && sd_journal_get_realtime_usec(journal, &realtime) == 0)
+          record.started = realtime / 1000;
+        // Without a boot id this only succeeds for the current boot
+        if (sd_journal_get_monotonic_usec(journal, &monotonic, &entryBoot) < 0)
+          continue;
+
+        QString unit = journalField(journal, "UNIT");
+        if (unit.isEmpty() || record.latencies.contains(unit))
+          continue;
+
+        // Only the first activation of a unit in the boot counts
+        if (journalField(journal, "MESSAGE_ID") == QLatin1String(idUnitStarting))
+        {
+          if (!starting.contains(unit))
+            starting.insert(unit, monotonic);
+        }
+        else if (starting.contains(unit))
+          record.latencies.insert(unit, (monotonic - starting.value(unit)) / 1000);
+      }
+      sd_journal_close(journal);
+    }
+
+    if (history)
+      QMetaObject::invokeMethod(history, "slotBootScanned", Qt::QueuedConnection, Q_ARG(BootRecord, record));
+  }
+
+private:
+  QPointer<BootHistory> history;
+  QString bootId;
+};
+
+QDataStream &operator<<(QDataStream &stream, const BootRecord &record)
+{
+  return stream << record.bootId << record.started << record.latencies;
+}
+
+QDataStream &operator>>(QDataStream &stream, BootRecord &record)
+{
+  return stream >> record.bootId >> record.started >> record.latencies;
+}
+
+BootHistory::BootHistory(QObject *parent)
+ : QObject(parent)
+{
+  qRegisterMetaType<BootRecord>("BootRecord");
+  loadCache();
+}
+
+BootHistory::~BootHistory()
+{
+  // The tasks only hold guarded pointers, but should not outlive the pool
+  pool.clear();
+  pool.waitForDone();
+}
+
+void BootHistory::refresh()
+{
+  if (listing || pendingScans > 0)
+    return;
+  listing = true;
+  pool.start(new ListBootsTask(this));
+}
+
+bool BootHistory::isScanning() const
+{
+  return listing || pendingScans > 0;
+}
+
+void BootHistory::slotBootsListed(const QStringList &bootIds, const QString &current)
+{
+  listing = false;
+  currentBoot = current;
+
+  // Forget boots that have been vacuumed from the journal
+  QSet<QString> present = bootIds.toSet();
+  QHash<QString, BootRecord>::iterator it = records.begin();
+  while (it != records.end())
+  {
+    if (!present.contains(it.key()))
+      it = records.erase(it);
+    else
+      ++it;
+  }
+
+  // The current boot is still being written, so it is always scanned
+  foreach (const QString &bootId, bootIds)
+  {
+    if (records.contains(bootId) && bootId != currentBoot)
+      continue;
+    ++pendingScans;
+    pool.start(new BootScanTask(this, bootId));
+  }
+
+  if (pendingScans == 0)
+    emit historyChanged();
+}
+
+void BootHistory::slotBootScanned(const BootRecord &record)
+{
+  if (record.started > 0)
+    records.insert(record.bootId, record);
+
+  if (--pendingScans == 0)
+  {
+    saveCache();
+    emit historyChanged();
+  }
+}
+
+static bool bootStartedBefore(const BootRecord &a, const BootRecord &b)
+{
+  return a.started < b.started;
+}
+
+QList<BootRecord> BootHistory::boots() const
+{
+  // Oldest boot first
+  QList<BootRecord> list = records.values();
+  std::sort(list.begin(), list.end(), bootStartedBefore);
+  return list;
+}
+
+QString BootHistory::cacheFile() const
+{
+  return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/kcmsystemd/boothistory";
+}
+
+void BootHistory::loadCache()
+{
+  QFile file(cacheFile());
+  if (!file.open(QIODevice::ReadOnly))
+    return;
+
+  QDataStream stream(&file);
+  quint32 magic, version;
+  stream >> magic >> version;
+  if (magic != cacheMagic || version != cacheVersion)
+    return;
+
+  QList<BootRecord> list;
+  stream >> list;
+  if (stream.status() != QDataStream::Ok)
+    return;
+  foreach (const BootRecord &record, list)
+    records.insert(record.bootId, record);
+}
+
+void BootHistory::saveCache() const
+{
+  // The current boot is not final, leave it out
+  QList<BootRecord> list;
+  foreach (const BootRecord &record, records)
+  {
+    if (record.bootId != currentBoot)
+      list << record;
+  }
+
+  QDir().mkpath(cacheFile().section('/', 0, -2));
+  QSaveFile file(cacheFile());
+  if (!file.open(QIODevice::WriteOnly))
+    return;
+
+  QDataStream stream(&file);
+  stream << cacheMagic << cacheVersion << list;
+  file.commit();
+}
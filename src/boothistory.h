@@ -0,0 +1,69 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef BOOTHISTORY_H
+#define BOOTHISTORY_H
+
+#include <QObject>
+#include <QHash>
+#include <QThreadPool>
+
+// Unit activation latencies of one boot, in milliseconds from the
+// "Starting" to the "Started" journal record of each unit
+struct BootRecord
+{
+  QString bootId;
+  qint64 started = 0;
+  QHash<QString, quint32> latencies;
+};
+Q_DECLARE_METATYPE(BootRecord)
+
+// Collects the unit activation latencies of all boots in the system journal.
+// Every boot is scanned by its own task in a thread pool. Finished boots
+// are cached on disk by boot id, so a refresh only scans boots that are not
+// in the cache, plus the current boot.
+class BootHistory : public QObject
+{
+  Q_OBJECT
+
+public:
+  BootHistory(QObject *parent = 0);
+  ~BootHistory();
+  void refresh();
+  bool isScanning() const;
+  QList<BootRecord> boots() const;
+
+signals:
+  void historyChanged();
+
+public slots:
+  void slotBootsListed(const QStringList &bootIds, const QString &currentBoot);
+  void slotBootScanned(const BootRecord &record);
+
+private:
+  QString cacheFile() const;
+  void loadCache();
+  void saveCache() const;
+  QHash<QString, BootRecord> records;
+  QString currentBoot;
+  QThreadPool pool;
+  int pendingScans = 0;
+  bool listing = false;
+  static const quint32 cacheMagic = 0x6b424854, cacheVersion = 1;
+};
+
+#endif // BOOTHISTORY_H
@@ -0,0 +1,152 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QColor>
+
+#include <KLocalizedString>
+
+#include <algorithm>
+
+#include "boothistorymodel.h"
+
+BootHistoryModel::BootHistoryModel(BootHistory *history, QObject *parent)
+ : QAbstractTableModel(parent), history(history)
+{
+  connect(history, SIGNAL(historyChanged()), this, SLOT(slotHistoryChanged()));
+  slotHistoryChanged();
+}
+
+int BootHistoryModel::rowCount(const QModelIndex &) const
+{
+  return units.size();
+}
+
+int BootHistoryModel::columnCount(const QModelIndex &) const
+{
+  return 6;
+}
+
+QVariant BootHistoryModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    return QVariant();
+
+  if (section == 0)
+    return i18n("Unit");
+  else if (section == 1)
+    return i18n("Boots");
+  else if (section == 2)
+    return i18n("Median");
+  else if (section == 3)
+    return i18n("Last boot");
+  else if (section == 4)
+    return i18n("Change");
+  else if (section == 5)
+    return i18n("Trend");
+  return QVariant();
+}
+
+QVariant BootHistoryModel::data(const QModelIndex & index, int role) const
+{
+  if (!index.isValid() || index.row() >= units.size())
+    return QVariant();
+
+  const UnitHistory &u = units.at(index.row());
+  int change = u.median > 0 ? int((qint64(u.last) - u.median) * 100 / u.median) : 0;
+
+  if (role == Qt::DisplayRole)
+  {
+    if (index.column() == 0)
+      return u.unit;
+    else if (index.column() == 1)
+      return u.latencies.size();
+    else if (index.column() == 2)
+      return QString("%1 ms").arg(u.median);
+    else if (index.column() == 3)
+      return QString("%1 ms").arg(u.last);
+    else if (index.column() == 4)
+      return QString("%1%2 %").arg(change > 0 ? "+" : "").arg(change);
+  }
+  else if (role == Qt::UserRole)
+  {
+    // Raw values for sorting
+    if (index.column() == 0)
+      return u.unit;
+    else if (index.column() == 1)
+      return u.latencies.size();
+    else if (index.column() == 2)
+      return u.median;
+    else if (index.column() == 3)
+      return u.last;
+    else if (index.column() == 4 || index.column() == 5)
+      return change;
+  }
+  else if (role == SeriesRole)
+  {
+    QVariantList series;
+    foreach (quint32 latency, u.latencies)
+      series << latency;
+    return series;
+  }
+  else if (role == Qt::ForegroundRole && u.regression)
+    return QColor(Qt::red);
+  else if (role == Qt::ToolTipRole && u.regression)
+    return i18n("%1 took %2 ms to start in the last boot, against a median of %3 ms.", u.unit, u.last, u.median);
+
+  return QVariant();
+}
+
+void BootHistoryModel::slotHistoryChanged()
+{
+  // Collect the latencies of every unit in boot order
+
+  QList<BootRecord> boots = history->boots();
+  QHash<QString, int> rowByUnit;
+  QList<UnitHistory> newUnits;
+  foreach (const BootRecord &boot, boots)
+  {
+    for (QHash<QString, quint32>::const_iterator it = boot.latencies.constBegin(); it != boot.latencies.constEnd(); ++it)
+    {
+      QHash<QString, int>::const_iterator row = rowByUnit.constFind(it.key());
+      if (row == rowByUnit.constEnd())
+      {
+        UnitHistory u;
+        u.unit = it.key();
+        rowByUnit.insert(it.key(), newUnits.size());
+        newUnits << u;
+        row = rowByUnit.constFind(it.key());
+      }
+      newUnits[row.value()].latencies << it.value();
+    }
+  }
+
+  for (int i = 0; i < newUnits.size(); ++i)
+  {
+    UnitHistory &u = newUnits[i];
+    QVector<quint32> sorted = u.latencies;
+    std::sort(sorted.begin(), sorted.end());
+    u.median = sorted.at(sorted.size() / 2);
+    u.last = u.latencies.last();
+    // Needs a few boots to compare with, and ignores jitter of fast units
+    u.regression = u.latencies.size() >= 3 && u.last > u.median * 3 / 2 && u.last - u.median >= 100;
+  }
+
+  beginResetModel();
+  units = newUnits;
+  bootCount = boots.size();
+  endResetModel();
+}
@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef BOOTHISTORYMODEL_H
+#define BOOTHISTORYMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+
+#include "boothistory.h"
+
+// Per-unit activation latency across boots. A unit is flagged as a
+// regression when its latency in the latest boot is well above its median.
+class BootHistoryModel : public QAbstractTableModel
+{
+  Q_OBJECT
+
+public:
+  enum { SeriesRole = Qt::UserRole + 1 };
+  BootHistoryModel(BootHistory *history, QObject *parent = 0);
+  int rowCount(const QModelIndex & parent = QModelIndex()) const;
+  int columnCount(const QModelIndex & parent = QModelIndex()) const;
+  QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+  QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+
+private slots:
+  void slotHistoryChanged();
+
+private:
+  struct UnitHistory
+  {
+    QString unit;
+    QVector<quint32> latencies;
+    quint32 median, last;
+    bool regression;
+  };
+  BootHistory *history;
+  QList<UnitHistory> units;
+  int bootCount = 0;
+};
+
+#endif // BOOTHISTORYMODEL_H
@@ -0,0 +1,209 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QFile>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cgroupsampler.h"
+
+CgroupSampler::CgroupSampler(QObject *parent)
+ : QObject(parent)
+{
+  root = cgroupRoot();
+
+  // The timer is a child, so it follows the sampler to the worker thread
+  timer = new QTimer(this);
+  timer->setInterval(1000);
+  connect(timer, SIGNAL(timeout()), this, SLOT(slotSample()));
+}
+
+CgroupSampler::~CgroupSampler()
+{
+  foreach (const CgroupFds &fds, openFds)
+    closeCgroup(fds);
+}
+
+QString CgroupSampler::cgroupRoot()
+{
+  // Find the mount point of the unified (v2) hierarchy
+  if (QFile::exists("/sys/fs/cgroup/cgroup.controllers"))
+    return "/sys/fs/cgroup";
+  else if (QFile::exists("/sys/fs/cgroup/unified/cgroup.controllers"))
+    return "/sys/fs/cgroup/unified";
+  return QString();
+}
+
+void CgroupSampler::setUnits(const CgroupPathMap &units)
+{
+  unitCgroups = units;
+
+  // Close descriptors of control groups that are no longer sampled
+  QSet<QString> wanted;
+  foreach (const QString &path, unitCgroups)
+    wanted.insert(path);
+
+  QHash<QString, CgroupFds>::iterator it = openFds.begin();
+  while (it != openFds.end())
+  {
+    if (!wanted.contains(it.key()))
+    {
+      closeCgroup(it.value());
+      it = openFds.erase(it);
+    }
+    else
+      ++it;
+  }
+}
+
+void CgroupSampler::setInterval(int msec)
+{
+  timer->setInterval(msec);
+}
+
+void CgroupSampler::start()
+{
+  timer->start();
+}
+
+void CgroupSampler::stop()
+{
+  timer->stop();
+}
+
+void CgroupSampler::slotSample()
+{
+  if (root.isEmpty() || unitCgroups.isEmpty())
+    return;
+
+  CgroupSampleMap samples;
+  char buf[8192];
+
+  for (CgroupPathMap::const_iterator it = unitCgroups.constBegin(); it != unitCgroups.constEnd(); ++it)
+  {
+    QHash<QString, CgroupFds>::iterator fdIt = openFds.find(it.value());
+    if (fdIt == openFds.end())
+      fdIt = openFds.insert(it.value(), openCgroup(it.value()));
+    const CgroupFds fds = fdIt.value();
+
+    // A group that could not be opened is retried on the next sample
+    if (fds.dir < 0)
+    {
+      openFds.erase(fdIt);
+      continue;
+    }
+
+    CgroupSample sample;
+
+    // cpu.stat starts with "usage_usec <n>". Reads fail once the group has
+    // been removed, e.g. when the unit was restarted, so reopen it next time.
+    int r = readFile(fds.cpu, buf, sizeof(buf));
+    if (r < 0 && fds.cpu >= 0)
+    {
+      closeCgroup(fds);
+      openFds.erase(fdIt);
+      continue;
+    }
+    else if (r > 0)
+    {
+      char *value = strstr(buf, "usage_usec ");
+      if (value)
+      {
+        sample.cpuUsec = strtoull(value + 11, NULL, 10);
+        sample.hasCpu = true;
+      }
+    }
+
+    if (readFile(fds.memory, buf, sizeof(buf)) > 0)
+    {
+      sample.memoryBytes = strtoull(buf, NULL, 10);
+      sample.hasMemory = true;
+    }
+
+    if (readFile(fds.pids, buf, sizeof(buf)) > 0)
+    {
+      sample.tasks = strtoull(buf, NULL, 10);
+      sample.hasTasks = true;
+    }
+
+    // io.stat has one line per device: "<maj:min> rbytes=<n> wbytes=<n> ..."
+    if (readFile(fds.io, buf, sizeof(buf)) >= 0)
+    {
+      char *pos = buf;
+      while ((pos = strstr(pos, "bytes=")) != NULL)
+      {
+        char kind = *(pos - 1);
+        qulonglong bytes = strtoull(pos + 6, &pos, 10);
+        if (kind == 'r')
+          sample.ioReadBytes += bytes;
+        else if (kind == 'w')
+          sample.ioWriteBytes += bytes;
+      }
+      sample.hasIo = true;
+    }
+
+    samples.insert(it.key(), sample);
+  }
+
+  emit samplesReady(samples);
+}
+
+CgroupSampler::CgroupFds CgroupSampler::openCgroup(const QString &path) const
+{
+  CgroupFds fds;
+  fds.dir = open(QFile::encodeName(root + path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fds.dir < 0)
+  {
+    fds.cpu = fds.memory = fds.pids = fds.io = -1;
+    return fds;
+  }
+
+  // Controllers that are not enabled for the group simply have no file
+  fds.cpu = openat(fds.dir, "cpu.stat", O_RDONLY | O_CLOEXEC);
+  fds.memory = openat(fds.dir, "memory.current", O_RDONLY | O_CLOEXEC);
+  fds.pids = openat(fds.dir, "pids.current", O_RDONLY | O_CLOEXEC);
+  fds.io = openat(fds.dir, "io.stat", O_RDONLY | O_CLOEXEC);
+  return fds;
+}
+
+void CgroupSampler::closeCgroup(const CgroupFds &fds) const
+{
+  int all[] = { fds.cpu, fds.memory, fds.pids, fds.io, fds.dir };
+  for (unsigned int i = 0; i < sizeof(all) / sizeof(all[0]); ++i)
+  {
+    if (all[i] >= 0)
+      close(all[i]);
+  }
+}
+
+int CgroupSampler::readFile(int fd, char *buf, int size)
+{
+  // Re-read a cgroup file from the start. Returns the number of bytes read,
+  // or -1 if the file is not available. The buffer is always terminated.
+  buf[0] = '\0';
+  if (fd < 0)
+    return -1;
+
+  ssize_t r = pread(fd, buf, size - 1, 0);
+  if (r < 0)
+    return -1;
+  buf[r] = '\0';
+  return r;
+}
@@ -0,0 +1,78 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef CGROUPSAMPLER_H
+#define CGROUPSAMPLER_H
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+
+// One sample of the cgroup v2 accounting files of a unit
+struct CgroupSample
+{
+  qulonglong cpuUsec = 0, memoryBytes = 0, tasks = 0, ioReadBytes = 0, ioWriteBytes = 0;
+  bool hasCpu = false, hasMemory = false, hasTasks = false, hasIo = false;
+};
+Q_DECLARE_METATYPE(CgroupSample)
+
+// Maps unit ids to control group paths and samples respectively
+typedef QHash<QString, QString> CgroupPathMap;
+typedef QHash<QString, CgroupSample> CgroupSampleMap;
+Q_DECLARE_METATYPE(CgroupPathMap)
+Q_DECLARE_METATYPE(CgroupSampleMap)
+
+// Reads cpu.stat, memory.current, pids.current and io.stat for a set of
+// control groups at a fixed interval. The object is meant to live in a worker
+// thread. Directory and file descriptors are kept open between samples and
+// the files are re-read with pread(), so a sample costs one syscall per file.
+class CgroupSampler : public QObject
+{
+  Q_OBJECT
+
+public:
+  CgroupSampler(QObject *parent = 0);
+  ~CgroupSampler();
+  static QString cgroupRoot();
+
+public slots:
+  void setUnits(const CgroupPathMap &units);
+  void setInterval(int msec);
+  void start();
+  void stop();
+
+signals:
+  void samplesReady(const CgroupSampleMap &samples);
+
+private slots:
+  void slotSample();
+
+private:
+  struct CgroupFds
+  {
+    int dir, cpu, memory, pids, io;
+  };
+  CgroupFds openCgroup(const QString &path) const;
+  void closeCgroup(const CgroupFds &fds) const;
+  static int readFile(int fd, char *buf, int size);
+  CgroupPathMap unitCgroups;
+  QHash<QString, CgroupFds> openFds;
+  QTimer *timer;
+  QString root;
+};
+
+#endif // CGROUPSAMPLER_H
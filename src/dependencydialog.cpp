@@ -0,0 +1,74 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QVBoxLayout>
+#include <QDialogButtonBox>
+
+#include <KLocalizedString>
+
+#include "dependencydialog.h"
+
+DependencyDialog::DependencyDialog(const DependencyGraph *graph, const QString &unit, QWidget *parent)
+ : QDialog(parent), graph(graph), unit(unit)
+{
+  setWindowTitle(i18n("Dependencies of %1", unit));
+  setAttribute(Qt::WA_DeleteOnClose);
+  resize(450, 500);
+
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  tree = new QTreeWidget(this);
+  tree->setHeaderHidden(true);
+  tree->setUniformRowHeights(true);
+  layout->addWidget(tree);
+  QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+  connect(buttons, SIGNAL(rejected()), this, SLOT(close()));
+  layout->addWidget(buttons);
+
+  connect(graph, SIGNAL(graphChanged()), this, SLOT(slotFill()));
+  connect(graph, SIGNAL(unitChanged(QString)), this, SLOT(slotFill()));
+  slotFill();
+}
+
+void DependencyDialog::slotFill()
+{
+  tree->clear();
+  if (!graph->isReady())
+  {
+    new QTreeWidgetItem(tree, QStringList() << i18n("Loading dependencies..."));
+    return;
+  }
+
+  addSection(i18n("Requires"), graph->dependencies(unit, depRequires));
+  addSection(i18n("Required by"), graph->reverseDependencies(unit, depRequires));
+  addSection(i18n("Wants"), graph->dependencies(unit, depWants));
+  addSection(i18n("Wanted by"), graph->reverseDependencies(unit, depWants));
+  addSection(i18n("Part of"), graph->dependencies(unit, depPartOf));
+  addSection(i18n("Has parts"), graph->reverseDependencies(unit, depPartOf));
+  addSection(i18n("Starts after"), graph->dependencies(unit, depAfter));
+  addSection(i18n("Starts before"), graph->dependencies(unit, depBefore));
+  addSection(i18n("Stopped along with it"), graph->stoppedWith(unit));
+}
+
+void DependencyDialog::addSection(const QString &title, const QStringList &units)
+{
+  QTreeWidgetItem *section = new QTreeWidgetItem(tree, QStringList() << QString("%1 (%2)").arg(title).arg(units.size()));
+  QList<QTreeWidgetItem *> items;
+  foreach (const QString &u, units)
+    items << new QTreeWidgetItem(QStringList() << u);
+  section->addChildren(items);
+  section->setExpanded(units.size() <= 20);
+}
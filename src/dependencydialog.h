@@ -0,0 +1,45 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef DEPENDENCYDIALOG_H
+#define DEPENDENCYDIALOG_H
+
+#include <QDialog>
+#include <QTreeWidget>
+
+#include "dependencygraph.h"
+
+// Shows the forward and reverse dependencies of one unit. It follows the
+// graph, so it fills in once the graph is built and updates with it.
+class DependencyDialog : public QDialog
+{
+  Q_OBJECT
+
+public:
+  DependencyDialog(const DependencyGraph *graph, const QString &unit, QWidget *parent = 0);
+
+private slots:
+  void slotFill();
+
+private:
+  void addSection(const QString &title, const QStringList &units);
+  const DependencyGraph *graph;
+  QString unit;
+  QTreeWidget *tree;
+};
+
+#endif // DEPENDENCYDIALOG_H
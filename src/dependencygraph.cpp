@@ -0,0 +1,365 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include "dependencygraph.h"
+
+DependencyGraph::DependencyGraph(const QDBusConnection &bus, QObject *parent)
+ : QObject(parent), bus(bus)
+{
+}
+
+QString DependencyGraph::propertyName(dependencyType type)
+{
+  if (type == depRequires)
+    return "Requires";
+  else if (type == depWants)
+    return "Wants";
+  else if (type == depAfter)
+    return "After";
+  else if (type == depBefore)
+    return "Before";
+  else if (type == depPartOf)
+    return "PartOf";
+  return QString();
+}
+
+void DependencyGraph::build(const QList<SystemdUnit> &units)
+{
+  // Fetch all loaded units in one pipelined batch, with a bounded number
+  // of calls in flight. A newer build makes the replies of an older one
+  // stale.
+
+  ++generation;
+  batchUnits.clear();
+  batchResults.clear();
+  batchQueue.clear();
+  batchRetries.clear();
+  batchInFlight = 0;
+  foreach (const SystemdUnit &unit, units)
+  {
+    if (!unit.unit_path.path().isEmpty())
+      batchUnits.insert(unit.unit_path.path(), unit.id);
+  }
+
+  pendingGetAll = batchUnits.size();
+  if (pendingGetAll == 0)
+  {
+    commitBatch();
+    return;
+  }
+  batchQueue = batchUnits.keys();
+  sendBatch();
+}
+
+void DependencyGraph::sendBatch()
+{
+  // The bus only allows a limited number of pending replies per connection
+  while (batchInFlight < maxInFlight && !batchQueue.isEmpty())
+  {
+    ++batchInFlight;
+    fetchUnit(batchQueue.takeFirst(), true);
+  }
+}
+
+void DependencyGraph::refreshUnit(const QString &path)
+{
+  if (ready && indexByPath.contains(path))
+    fetchUnit(path, false);
+}
+
+void DependencyGraph::fetchUnit(const QString &path, bool batch)
+{
+  QDBusMessage msg = QDBusMessage::createMethodCall(connSystemd, path, ifaceDbusProp, "GetAll");
+  msg << ifaceUnit;
+  QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(bus.asyncCall(msg), this);
+  watcher->setProperty("path", path);
+  watcher->setProperty("batch", batch);
+  watcher->setProperty("generation", generation);
+  connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(slotGetAllFinished(QDBusPendingCallWatcher*)));
+}
+
+void DependencyGraph::slotGetAllFinished(QDBusPendingCallWatcher *watcher)
+{
+  QDBusPendingReply<QVariantMap> reply = *watcher;
+  QString path = watcher->property("path").toString();
+  bool batch = watcher->property("batch").toBool();
+  int gen = watcher->property("generation").toInt();
+  watcher->deleteLater();
+
+  if (gen != generation)
+    return;
+
+  if (batch)
+  {
+    --batchInFlight;
+    if (reply.isError() && reply.error().name() == "org.freedesktop.DBus.Error.LimitsExceeded" &&
+        ++batchRetries[path] <= maxRetries)
+    {
+      // Asked again once other calls have finished
+      batchQueue << path;
+      sendBatch();
+      return;
+    }
+
+    // Units that were unloaded in the meantime are left out
+    if (!reply.isError())
+      batchResults.insert(path, reply.value());
+    else if (reply.error().name() != "org.freedesktop.DBus.Error.UnknownObject")
+      qDebug() << "Dependencies of" << batchUnits.value(path) << "not read:" << reply.error().message();
+    if (--pendingGetAll == 0)
+      commitBatch();
+    else
+      sendBatch();
+    return;
+  }
+
+  QHash<QString, int>::const_iterator it = indexByPath.constFind(path);
+  if (reply.isError() || it == indexByPath.constEnd())
+    return;
+
+  applyProperties(it.value(), reply.value());
+  emit unitChanged(names.at(it.value()));
+}
+
+void DependencyGraph::commitBatch()
+{
+  names.clear();
+  indexByName.clear();
+  indexByPath.clear();
+  for (int type = 0; type < depTypeCount; ++type)
+  {
+    forward[type].clear();
+    reverse[type].clear();
+  }
+  times.clear();
+
+  // Index the loaded units first, so they are numbered together
+  for (QHash<QString, QVariantMap>::const_iterator it = batchResults.constBegin(); it != batchResults.constEnd(); ++it)
+    indexByPath.insert(it.key(), nodeIndex(batchUnits.value(it.key())));
+
+  for (QHash<QString, QVariantMap>::const_iterator it = batchResults.constBegin(); it != batchResults.constEnd(); ++it)
+    applyProperties(indexByPath.value(it.key()), it.value());
+
+  batchUnits.clear();
+  batchResults.clear();
+  batchRetries.clear();
+  ready = true;
+  emit graphChanged();
+}
+
+void DependencyGraph::updateUnit(const QString &path, const QVariantMap &changed, const QStringList &invalidated)
+{
+  // Patches the edges of one unit from PropertiesChanged. Invalidated
+  // dependency properties carry no value, so the unit is fetched again.
+
+  QHash<QString, int>::const_iterator it = indexByPath.constFind(path);
+  if (!ready || it == indexByPath.constEnd())
+    return;
+
+  bool refetch = false, patched = false;
+  for (int type = 0; type < depTypeCount; ++type)
+  {
+    QString prop = propertyName(static_cast<dependencyType>(type));
+    if (invalidated.contains(prop))
+      refetch = true;
+    else if (changed.contains(prop))
+    {
+      setEdges(it.value(), static_cast<dependencyType>(type), changed.value(prop).toStringList());
+      patched = true;
+    }
+  }
+
+  if (changed.contains("InactiveExitTimestampMonotonic"))
+    times[it.value()].activating = changed.value("InactiveExitTimestampMonotonic").toULongLong();
+  if (changed.contains("ActiveEnterTimestampMonotonic"))
+    times[it.value()].activated = changed.value("ActiveEnterTimestampMonotonic").toULongLong();
+
+  if (refetch)
+    fetchUnit(path, false);
+  else if (patched)
+    emit unitChanged(names.at(it.value()));
+}
+
+void DependencyGraph::applyProperties(int node, const QVariantMap &props)
+{
+  for (int type = 0; type < depTypeCount; ++type)
+    setEdges(node, static_cast<dependencyType>(type), props.value(propertyName(static_cast<dependencyType>(type))).toStringList());
+  times[node].activating = props.value("InactiveExitTimestampMonotonic").toULongLong();
+  times[node].activated = props.value("ActiveEnterTimestampMonotonic").toULongLong();
+}
+
+int DependencyGraph::nodeIndex(const QString &unit)
+{
+  QHash<QString, int>::const_iterator it = indexByName.constFind(unit);
+  if (it != indexByName.constEnd())
+    return it.value();
+
+  int node = names.size();
+  names << unit;
+  indexByName.insert(unit, node);
+  for (int type = 0; type < depTypeCount; ++type)
+  {
+    forward[type].resize(node + 1);
+    reverse[type].resize(node + 1);
+  }
+  times.resize(node + 1);
+  return node;
+}
+
+void DependencyGraph::setEdges(int from, dependencyType type, const QStringList &targets)
+{
+  // Drop the old edges from the reverse arrays before adding the new ones
+  foreach (int to, forward[type].at(from))
+  {
+    QVector<int> &back = reverse[type][to];
+    int pos = back.indexOf(from);
+    if (pos != -1)
+    {
+      back[pos] = back.last();
+      back.removeLast();
+    }
+  }
+
+  QVector<int> edges;
+  edges.reserve(targets.size());
+  foreach (const QString &target, targets)
+  {
+    int to = nodeIndex(target);
+    edges << to;
+    reverse[type][to] << from;
+  }
+  forward[type][from] = edges;
+}
+
+bool DependencyGraph::isReady() const
+{
+  return ready;
+}
+
+bool DependencyGraph::isBuilding() const
+{
+  return pendingGetAll > 0;
+}
+
+QStringList DependencyGraph::dependencies(const QString &unit, dependencyType type) const
+{
+  QHash<QString, int>::const_iterator it = indexByName.constFind(unit);
+  if (it == indexByName.constEnd())
+    return QStringList();
+  return namesOf(forward[type].at(it.value()));
+}
+
+QStringList DependencyGraph::reverseDependencies(const QString &unit, dependencyType type) const
+{
+  QHash<QString, int>::const_iterator it = indexByName.constFind(unit);
+  if (it == indexByName.constEnd())
+    return QStringList();
+  return namesOf(reverse[type].at(it.value()));
+}
+
+QStringList DependencyGraph::stoppedWith(const QString &unit) const
+{
+  // Units that are stopped along with this one: everything that requires
+  // it or is part of it, transitively
+
+  QHash<QString, int>::const_iterator it = indexByName.constFind(unit);
+  if (it == indexByName.constEnd())
+    return QStringList();
+
+  QVector<bool> seen(names.size(), false);
+  QVector<int> queue, result;
+  queue << it.value();
+  seen[it.value()] = true;
+  for (int i = 0; i < queue.size(); ++i)
+  {
+    int node = queue.at(i);
+    foreach (dependencyType type, QList<dependencyType>() << depRequires << depPartOf)
+    {
+      foreach (int from, reverse[type].at(node))
+      {
+        if (seen.at(from))
+          continue;
+        seen[from] = true;
+        queue << from;
+        result << from;
+      }
+    }
+  }
+  return namesOf(result);
+}
+
+QStringList DependencyGraph::criticalChain(const QString &unit) const
+{
+  // Like systemd-analyze critical-chain: from the unit, repeatedly follow
+  // the After dependency that was activated last before the unit started
+  // activating. Each step only scans the After edges of one unit.
+
+  QStringList chain;
+  QHash<QString, int>::const_iterator it = indexByName.constFind(unit);
+  if (it == indexByName.constEnd())
+    return chain;
+
+  QVector<bool> seen(names.size(), false);
+  int node = it.value();
+  while (node != -1 && !seen.at(node))
+  {
+    seen[node] = true;
+    chain << names.at(node);
+
+    quint64 start = times.at(node).activating ? times.at(node).activating : times.at(node).activated;
+    int next = -1;
+    quint64 latest = 0;
+    foreach (int dep, forward[depAfter].at(node))
+    {
+      quint64 activated = times.at(dep).activated;
+      if (activated > latest && activated <= start)
+      {
+        latest = activated;
+        next = dep;
+      }
+    }
+    node = next;
+  }
+  return chain;
+}
+
+QStringList DependencyGraph::loadedUnits() const
+{
+  QStringList list;
+  list.reserve(indexByPath.size());
+  foreach (int node, indexByPath)
+    list << names.at(node);
+  return list;
+}
+
+UnitTimes DependencyGraph::unitTimes(const QString &unit) const
+{
+  QHash<QString, int>::const_iterator it = indexByName.constFind(unit);
+  if (it == indexByName.constEnd())
+    return UnitTimes();
+  return times.at(it.value());
+}
+
+QStringList DependencyGraph::namesOf(const QVector<int> &nodes) const
+{
+  QStringList list;
+  list.reserve(nodes.size());
+  foreach (int node, nodes)
+    list << names.at(node);
+  list.sort();
+  return list;
+}
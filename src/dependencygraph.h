@@ -0,0 +1,95 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef DEPENDENCYGRAPH_H
+#define DEPENDENCYGRAPH_H
+
+#include <QObject>
+#include <QVector>
+#include <QtDBus/QtDBus>
+
+#include "systemdunit.h"
+
+enum dependencyType
+{
+  depRequires, depWants, depAfter, depBefore, depPartOf, depTypeCount
+};
+
+// Activation timestamps of a unit, in microseconds since boot
+struct UnitTimes
+{
+  quint64 activating = 0, activated = 0;
+};
+
+// The dependencies between the units of one bus. Every unit, including
+// units that are only referenced, gets an index, and the edges of each
+// dependency type are kept as adjacency arrays in both directions, so
+// forward and reverse queries only touch the neighbours of a unit.
+// The graph is built from one pipelined batch of GetAll calls, with a
+// bounded number in flight, and patched per unit afterwards. The same sweep collects the activation timestamps.
+class DependencyGraph : public QObject
+{
+  Q_OBJECT
+
+public:
+  DependencyGraph(const QDBusConnection &bus, QObject *parent = 0);
+  void build(const QList<SystemdUnit> &units);
+  void refreshUnit(const QString &path);
+  void updateUnit(const QString &path, const QVariantMap &changed, const QStringList &invalidated);
+  bool isReady() const;
+  bool isBuilding() const;
+  QStringList dependencies(const QString &unit, dependencyType type) const;
+  QStringList reverseDependencies(const QString &unit, dependencyType type) const;
+  QStringList stoppedWith(const QString &unit) const;
+  QStringList criticalChain(const QString &unit) const;
+  QStringList loadedUnits() const;
+  UnitTimes unitTimes(const QString &unit) const;
+  static QString propertyName(dependencyType type);
+
+signals:
+  void graphChanged();
+  void unitChanged(const QString &unit);
+
+private slots:
+  void slotGetAllFinished(QDBusPendingCallWatcher *watcher);
+
+private:
+  void fetchUnit(const QString &path, bool batch);
+  void sendBatch();
+  void commitBatch();
+  int nodeIndex(const QString &unit);
+  void setEdges(int from, dependencyType type, const QStringList &targets);
+  void applyProperties(int node, const QVariantMap &props);
+  QStringList namesOf(const QVector<int> &nodes) const;
+  QDBusConnection bus;
+  QStringList names;
+  QHash<QString, int> indexByName, indexByPath;
+  QVector<QVector<int> > forward[depTypeCount], reverse[depTypeCount];
+  QVector<UnitTimes> times;
+  QHash<QString, QString> batchUnits;
+  QHash<QString, QVariantMap> batchResults;
+  QStringList batchQueue;
+  QHash<QString, int> batchRetries;
+  int pendingGetAll = 0, batchInFlight = 0, generation = 0;
+  static const int maxInFlight = 32, maxRetries = 3;
+  bool ready = false;
+  const QString connSystemd = "org.freedesktop.systemd1";
+  const QString ifaceUnit = "org.freedesktop.systemd1.Unit";
+  const QString ifaceDbusProp = "org.freedesktop.DBus.Properties";
+};
+
+#endif // DEPENDENCYGRAPH_H
@@ -21,6 +21,7 @@
 #include <QFile>
 
 #include "../config.h"
+#include "../unitfilechanges.h"
 
 ActionReply Helper::save(const QVariantMap& args)
 {
@@ -79,11 +80,17 @@ ActionReply Helper::dbusaction(const QVariantMap& args)
     }
   }
 
-  // Reload systemd daemon to update the enabled/disabled status
-  if (method == "EnableUnitFiles" || method == "DisableUnitFiles" || method == "MaskUnitFiles" || method == "UnmaskUnitFiles")
+  // Job methods reply with the path of the queued job
+  if (dbusreply.type() == QDBusMessage::ReplyMessage &&
+      !dbusreply.arguments().isEmpty() &&
+      dbusreply.arguments().at(0).canConvert<QDBusObjectPath>())
+    reply.addData("jobPath", dbusreply.arguments().at(0).value<QDBusObjectPath>().path());
+
+  // Reload systemd daemon to update the enabled/disabled status. systemd
+  // does not update properties when unit files change, so reload, but only
+  // if the reply reported changed symlinks.
+  if (isUnitFileMethod(method) && unitFileChangeCount(dbusreply) > 0)
   {
-    // systemd does not update properties when these methods are called so we
-    // need to reload the systemd daemon.
     iface = new QDBusInterface ("org.freedesktop.systemd1",
 				"/org/freedesktop/systemd1",
 				"org.freedesktop.systemd1.Manager",
@@ -96,4 +103,77 @@ ActionReply Helper::dbusaction(const QVariantMap& args)
   return reply;
 }
 
+ActionReply Helper::batchaction(const QVariantMap& args)
+{
+  // Applies one Manager method to a set of units. The unit file methods take
+  // all units in one call. Jobs are submitted asynchronously with at most
+  // maxParallel calls in flight. The reply maps every unit to an error
+  // message, which is empty on success.
+
+  ActionReply reply;
+  QString method = args["method"].toString();
+  QStringList units = args["units"].toStringList();
+  int maxParallel = qMax(1, args.value("maxParallel", 8).toInt());
+  QVariantMap results;
+
+  QDBusConnection systembus = QDBusConnection::systemBus();
+
+  if (isUnitFileMethod(method))
+  {
+    QDBusMessage msg = QDBusMessage::createMethodCall("org.freedesktop.systemd1",
+                                                      "/org/freedesktop/systemd1",
+                                                      "org.freedesktop.systemd1.Manager",
+                                                      method);
+    msg << units << false;
+    if (method == "EnableUnitFiles" || method == "MaskUnitFiles")
+      msg << true;
+    QDBusMessage dbusreply = systembus.call(msg);
+
+    QString error;
+    if (dbusreply.type() == QDBusMessage::ErrorMessage)
+      error = dbusreply.errorMessage();
+    foreach (const QString &unit, units)
+      results[unit] = error;
+
+    // One reload for the whole set, if anything changed
+    if (unitFileChangeCount(dbusreply) > 0)
+      systembus.call(QDBusMessage::createMethodCall("org.freedesktop.systemd1",
+                                                    "/org/freedesktop/systemd1",
+                                                    "org.freedesktop.systemd1.Manager",
+                                                    "Reload"));
+  }
+  else if (method == "StartUnit" || method == "StopUnit" || method == "RestartUnit" || method == "ReloadUnit")
+  {
+    QList<QPair<QString, QDBusPendingCall> > inFlight;
+    int next = 0;
+    while (next < units.size() || !inFlight.isEmpty())
+    {
+      while (next < units.size() && inFlight.size() < maxParallel)
+      {
+        QDBusMessage msg = QDBusMessage::createMethodCall("org.freedesktop.systemd1",
+                                                          "/org/freedesktop/systemd1",
+                                                          "org.freedesktop.systemd1.Manager",
+                                                          method);
+        msg << units.at(next) << "replace";
+        inFlight << qMakePair(units.at(next), systembus.asyncCall(msg));
+        ++next;
+      }
+
+      // The calls only queue jobs, so they finish roughly in order
+      QPair<QString, QDBusPendingCall> call = inFlight.takeFirst();
+      call.second.waitForFinished();
+      results[call.first] = call.second.isError() ? call.second.error().message() : QString();
+    }
+  }
+  else
+  {
+    reply = ActionReply::HelperErrorReply();
+    reply.setErrorDescription(QString("Unsupported batch method: %1").arg(method));
+    return reply;
+  }
+
+  reply.addData("results", results);
+  return reply;
+}
+
 KAUTH_HELPER_MAIN("org.kde.kcontrol.kcmsystemd", Helper)
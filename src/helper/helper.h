@@ -28,6 +28,7 @@ class Helper : public QObject
   public Q_SLOTS:
     ActionReply save(const QVariantMap& args);
     ActionReply dbusaction(const QVariantMap& args);
+    ActionReply batchaction(const QVariantMap& args);
 };
 
 #endif
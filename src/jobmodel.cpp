@@ -0,0 +1,261 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QColor>
+#include <QIcon>
+
+#include <KLocalizedString>
+
+#include <algorithm>
+
+#include "jobmodel.h"
+
+JobModel::JobModel(QObject *parent)
+ : QAbstractTableModel(parent)
+{
+  clock.start();
+
+  // Refreshes the durations of running jobs
+  ticker = new QTimer(this);
+  ticker->setInterval(1000);
+  connect(ticker, SIGNAL(timeout()), this, SLOT(slotTick()));
+}
+
+int JobModel::rowCount(const QModelIndex &) const
+{
+  return jobs.size();
+}
+
+int JobModel::columnCount(const QModelIndex &) const
+{
+  return 5;
+}
+
+QVariant JobModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    return QVariant();
+
+  if (section == 0)
+    return i18n("Job ID");
+  else if (section == 1)
+    return i18n("Unit");
+  else if (section == 2)
+    return i18n("Type");
+  else if (section == 3)
+    return i18n("Result");
+  else if (section == 4)
+    return i18n("Duration");
+  return QVariant();
+}
+
+QVariant JobModel::data(const QModelIndex & index, int role) const
+{
+  if (!index.isValid() || index.row() >= jobs.size())
+    return QVariant();
+
+  const Job &job = jobs.at(index.row());
+  qint64 msecs = (job.finished >= 0 ? job.finished : clock.elapsed()) - job.started;
+
+  if (role == Qt::DisplayRole)
+  {
+    if (index.column() == 0)
+      return job.id;
+    else if (index.column() == 1)
+      return job.unit;
+    else if (index.column() == 2)
+      return job.type;
+    else if (index.column() == 3)
+      return job.finished >= 0 ? job.result : i18n("running");
+    else if (index.column() == 4)
+      return QString::number(msecs / 1000.0, 'f', 1) + " s";
+  }
+  else if (role == Qt::UserRole)
+  {
+    // Raw values for sorting
+    if (index.column() == 0)
+      return job.id;
+    else if (index.column() == 4)
+      return msecs;
+    return data(index, Qt::DisplayRole);
+  }
+  else if (role == Qt::DecorationRole && index.column() == 0)
+  {
+    if (job.bus == user)
+      return QIcon::fromTheme("user-identity");
+    return QIcon::fromTheme("object-locked");
+  }
+  else if (role == Qt::ForegroundRole && index.column() == 3)
+  {
+    if (job.finished < 0)
+      return QColor(Qt::darkCyan);
+    else if (job.result == "done")
+      return QColor(Qt::darkGreen);
+    else if (job.result != "skipped")
+      return QColor(Qt::red);
+  }
+
+  return QVariant();
+}
+
+quint64 JobModel::jobKey(uint id, dbusBus bus)
+{
+  return (quint64(bus) << 32) | id;
+}
+
+void JobModel::jobNew(uint id, const QString &unit, const QString &type, dbusBus bus)
+{
+  quint64 key = jobKey(id, bus);
+  if (rowByKey.contains(key))
+    return;
+
+  Job job;
+  job.id = id;
+  job.bus = bus;
+  job.unit = unit;
+  job.type = type;
+  job.started = clock.elapsed();
+  job.finished = -1;
+
+  beginInsertRows(QModelIndex(), jobs.size(), jobs.size());
+  rowByKey.insert(key, jobs.size());
+  jobs << job;
+  endInsertRows();
+
+  ++running;
+  if (!ticker->isActive())
+    ticker->start();
+  emit statsChanged();
+}
+
+void JobModel::setJobType(uint id, const QString &type, dbusBus bus)
+{
+  QHash<quint64, int>::const_iterator it = rowByKey.constFind(jobKey(id, bus));
+  if (it == rowByKey.constEnd())
+    return;
+
+  jobs[it.value()].type = type;
+  emit dataChanged(index(it.value(), 2), index(it.value(), 2));
+}
+
+void JobModel::jobRemoved(uint id, const QString &unit, const QString &result, dbusBus bus)
+{
+  QHash<quint64, int>::const_iterator it = rowByKey.constFind(jobKey(id, bus));
+  if (it == rowByKey.constEnd())
+  {
+    // The job was queued before we started listening
+    jobNew(id, unit, QString(), bus);
+    it = rowByKey.constFind(jobKey(id, bus));
+  }
+
+  Job &job = jobs[it.value()];
+  if (job.finished >= 0)
+    return;
+  job.finished = clock.elapsed();
+  job.result = result;
+  emit dataChanged(index(it.value(), 0), index(it.value(), columnCount() - 1));
+
+  --running;
+  if (running == 0)
+    ticker->stop();
+
+  finishTimes << job.finished;
+  while (!finishTimes.isEmpty() && finishTimes.first() < job.finished - rateWindow)
+    finishTimes.removeFirst();
+
+  emit jobFinished(id, bus, job.unit, result, job.finished - job.started);
+  dropFinished();
+  emit statsChanged();
+}
+
+int JobModel::runningJobs() const
+{
+  return running;
+}
+
+double JobModel::jobsPerSecond() const
+{
+  // Finished jobs over the last rateWindow milliseconds
+  qint64 now = clock.elapsed();
+  int count = 0;
+  foreach (qint64 finished, finishTimes)
+  {
+    if (finished >= now - rateWindow)
+      ++count;
+  }
+  return count * 1000.0 / rateWindow;
+}
+
+QStringList JobModel::slowestJobs(int count) const
+{
+  QList<QPair<qint64, QString> > durations;
+  foreach (const Job &job, jobs)
+  {
+    if (job.finished >= 0)
+      durations << qMakePair(job.finished - job.started, job.unit);
+  }
+  std::sort(durations.begin(), durations.end());
+
+  QStringList slowest;
+  for (int i = durations.size() - 1; i >= 0 && slowest.size() < count; --i)
+    slowest << QString("%1 (%2 s)").arg(durations.at(i).second).arg(durations.at(i).first / 1000.0, 0, 'f', 1);
+  return slowest;
+}
+
+void JobModel::slotTick()
+{
+  // Only the duration column of running jobs changes
+  int top = -1, bottom = -1;
+  for (int row = 0; row < jobs.size(); ++row)
+  {
+    if (jobs.at(row).finished >= 0)
+      continue;
+    if (top == -1)
+      top = row;
+    bottom = row;
+  }
+  if (top != -1)
+    emit dataChanged(index(top, 4), index(bottom, 4));
+  emit statsChanged();
+}
+
+void JobModel::dropFinished()
+{
+  // Drop the oldest finished jobs, which are at the top
+  int finished = jobs.size() - running;
+  if (finished <= maxFinished)
+    return;
+
+  int drop = finished - maxFinished;
+  int row = 0;
+  while (drop > 0 && row < jobs.size())
+  {
+    if (jobs.at(row).finished < 0)
+    {
+      ++row;
+      continue;
+    }
+    beginRemoveRows(QModelIndex(), row, row);
+    jobs.removeAt(row);
+    endRemoveRows();
+    --drop;
+  }
+
+  rowByKey.clear();
+  for (int i = 0; i < jobs.size(); ++i)
+    rowByKey.insert(jobKey(jobs.at(i).id, jobs.at(i).bus), i);
+}
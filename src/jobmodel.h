@@ -0,0 +1,74 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef JOBMODEL_H
+#define JOBMODEL_H
+
+#include <QAbstractTableModel>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include "systemdunit.h"
+
+// The systemd job queue of both buses, fed by the JobNew and JobRemoved
+// signals. Running jobs are listed with their elapsed time, finished jobs
+// are kept with their result and duration until maxFinished is reached.
+class JobModel : public QAbstractTableModel
+{
+  Q_OBJECT
+
+public:
+  JobModel(QObject *parent = 0);
+  int rowCount(const QModelIndex & parent = QModelIndex()) const;
+  int columnCount(const QModelIndex & parent = QModelIndex()) const;
+  QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+  QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+  void jobNew(uint id, const QString &unit, const QString &type, dbusBus bus);
+  void setJobType(uint id, const QString &type, dbusBus bus);
+  void jobRemoved(uint id, const QString &unit, const QString &result, dbusBus bus);
+  int runningJobs() const;
+  double jobsPerSecond() const;
+  QStringList slowestJobs(int count) const;
+
+signals:
+  void jobFinished(uint id, int bus, const QString &unit, const QString &result, qint64 msecs);
+  void statsChanged();
+
+private slots:
+  void slotTick();
+
+private:
+  struct Job
+  {
+    uint id;
+    dbusBus bus;
+    QString unit, type, result;
+    qint64 started, finished;
+  };
+  static quint64 jobKey(uint id, dbusBus bus);
+  void dropFinished();
+  QList<Job> jobs;
+  QHash<quint64, int> rowByKey;
+  QList<qint64> finishTimes;
+  QElapsedTimer clock;
+  QTimer *ticker;
+  int running = 0;
+  static const int maxFinished = 500;
+  static const int rateWindow = 10000;
+};
+
+#endif // JOBMODEL_H
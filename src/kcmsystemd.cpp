@@ -18,19 +18,27 @@
 #include "kcmsystemd.h"
 #include <config.h>
 
-#include <QMouseEvent>
 #include <QMenu>
+#include <QScrollBar>
 #include <QThread>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QSpinBox>
+#include <QShowEvent>
 
 #include <KAboutData>
 #include <KPluginFactory>
 #include <KMessageBox>
 #include <KMimeTypeTrader>
 #include <KAuth>
+#include <KSharedConfig>
+#include <KConfigGroup>
 using namespace KAuth;
 
 #include <boost/filesystem.hpp>
 
+#include <algorithm>
+
 // Static members
 ConfModel *kcmsystemd::confModel = new ConfModel();
 QList<confOption> kcmsystemd::confOptList;
@@ -54,10 +62,17 @@ kcmsystemd::kcmsystemd(QWidget *parent, const QVariantList &args) : KCModule(par
   setNeedsAuthorization(true);
   ui.leSearchUnit->setFocus();
 
+  // Only the work needed for the first paint is done here. Each tab is
+  // initialized when it is first shown, or in the background afterwards.
+  startupClock.start();
+  QElapsedTimer phaseClock;
+  phaseClock.start();
+
   // See if systemd is reachable via dbus
-  if (getDbusProperty("Version", sysdMgr) != "invalidIface")
+  QVariant version = getDbusProperty("Version", sysdMgr);
+  if (version != "invalidIface")
   {
-    systemdVersion = getDbusProperty("Version", sysdMgr).toString().remove("systemd ").toInt();
+    systemdVersion = version.toString().remove("systemd ").toInt();
     qDebug() << "Detected systemd" << systemdVersion;
   }
   else
@@ -78,11 +93,6 @@ kcmsystemd::kcmsystemd(QWidget *parent, const QVariantList &args) : KCModule(par
     enableUserUnits = false;
   }
 
-  // Use kf5-config to get kde prefix
-  kdeConfig = new QProcess(this);
-  connect(kdeConfig, SIGNAL(readyReadStandardOutput()), this, SLOT(slotKdeConfig()));
-  kdeConfig->start("kf5-config", QStringList() << "--prefix");
-  
   // Find the configuration directory
   if (QDir("/etc/systemd").exists()) {
     etcDir = "/etc/systemd";
@@ -100,54 +110,45 @@ kcmsystemd::kcmsystemd(QWidget *parent, const QVariantList &args) : KCModule(par
   if (systemdVersion >= 215)
     listConfFiles << "coredump.conf";
   
-  // Use boost to find persistent partition size
-  boost::filesystem::path pp ("/var/log");
-  boost::filesystem::space_info logPpart = boost::filesystem::space(pp);
-  partPersSizeMB = logPpart.capacity / 1024 / 1024;
-  
-  // Use boost to find volatile partition size
-  boost::filesystem::path pv ("/run/log");
-  boost::filesystem::space_info logVpart = boost::filesystem::space(pv);
-  partVolaSizeMB = logVpart.capacity / 1024 / 1024;
-  qDebug() << "Persistent partition size found to: " << partPersSizeMB << "MB";
-  qDebug() << "Volatile partition size found to: " << partVolaSizeMB << "MB";
-  
-  setupConfigParms();
-  setupSignalSlots();
-  
-  // Subscribe to dbus signals from systemd system daemon and connect them to slots
-  callDbusMethod("Subscribe", sysdMgr);
-  systembus.connect(connSystemd, pathSysdMgr, ifaceMgr, "Reloading", this, SLOT(slotSystemSystemdReloading(bool)));
-  // systembus.connect(connSystemd, pathSysdMgr, ifaceMgr, "UnitNew", this, SLOT(slotUnitLoaded(QString, QDBusObjectPath)));
-  // systembus.connect(connSystemd,pathSysdMgr, ifaceMgr, "UnitRemoved", this, SLOT(slotUnitUnloaded(QString, QDBusObjectPath)));
-  systembus.connect(connSystemd, pathSysdMgr, ifaceMgr, "UnitFilesChanged", this, SLOT(slotSystemUnitsChanged()));
-  systembus.connect(connSystemd, "", ifaceDbusProp, "PropertiesChanged", this, SLOT(slotSystemUnitsChanged()));
-  // We need to use the JobRemoved signal, because stopping units does not emit PropertiesChanged signal
-  systembus.connect(connSystemd, pathSysdMgr, ifaceMgr, "JobRemoved", this, SLOT(slotSystemUnitsChanged()));
-
-  // Subscribe to dbus signals from systemd user daemon and connect them to slots
-  callDbusMethod("Subscribe", sysdMgr, user);
-  QDBusConnection userbus = QDBusConnection::connectToBus(userBusPath, connSystemd);
-  userbus.connect(connSystemd, pathSysdMgr, ifaceMgr, "Reloading", this, SLOT(slotUserSystemdReloading(bool)));
-  userbus.connect(connSystemd, pathSysdMgr, ifaceMgr, "UnitFilesChanged", this, SLOT(slotUserUnitsChanged()));
-  userbus.connect(connSystemd, "", ifaceDbusProp, "PropertiesChanged", this, SLOT(slotUserUnitsChanged()));
-  userbus.connect(connSystemd, pathSysdMgr, ifaceMgr, "JobRemoved", this, SLOT(slotUserUnitsChanged()));
-
-  // logind
-  systembus.connect(connLogind, "", ifaceDbusProp, "PropertiesChanged", this, SLOT(slotLogindPropertiesChanged(QString, QVariantMap, QStringList)));
-  
-  // Get list of units
-  slotRefreshUnitsList(true, sys);
-  slotRefreshUnitsList(true, user);
+  logStartupPhase("systemd detection", phaseClock);
 
+  setupSignalSlots();
   setupUnitslist();
-  setupConf();
-  setupSessionlist();
-  setupTimerlist();
+  setupUnitFetchers();
+  restoreSnapshot();
+  setupMonitor();
+  setupJobList();
+  setupBootAnalysis();
+  connect(ui.tabWidget, SIGNAL(currentChanged(int)), this, SLOT(slotTabChanged(int)));
+  logStartupPhase("models and views", phaseClock);
+  setupDone = true;
+}
+
+void kcmsystemd::showEvent(QShowEvent *event)
+{
+  // Continue after the first paint, which is queued behind the show event
+  KCModule::showEvent(event);
+  if (setupDone && !startupShown)
+  {
+    startupShown = true;
+    QTimer::singleShot(0, this, SLOT(slotStartupPainted()));
+  }
 }
 
 kcmsystemd::~kcmsystemd()
 {
+  saveSnapshot();
+
+  // The samplers and fetchers are deleted by their worker threads when
+  // they finish
+  foreach (QThread *thread, QList<QThread *>() << monitorThread << systemFetchThread << userFetchThread)
+  {
+    if (thread)
+    {
+      thread->quit();
+      thread->wait();
+    }
+  }
 }
 
 QDBusArgument &operator<<(QDBusArgument &argument, const SystemdUnit &unit)
@@ -184,28 +185,132 @@ const QDBusArgument &operator>>(const QDBusArgument &argument, SystemdUnit &unit
      return argument;
 }
 
-QDBusArgument &operator<<(QDBusArgument &argument, const SystemdSession &session)
+void kcmsystemd::logStartupPhase(const char *phase, QElapsedTimer &phaseClock)
 {
-  argument.beginStructure();
-  argument << session.session_id
-     << session.user_id
-     << session.user_name
-     << session.seat_id
-     << session.session_path;
-  argument.endStructure();
-  return argument;
+  qDebug() << "Startup phase" << phase << "took" << phaseClock.restart() << "ms,"
+           << startupClock.elapsed() << "ms since start";
 }
 
-const QDBusArgument &operator>>(const QDBusArgument &argument, SystemdSession &session)
+void kcmsystemd::slotStartupPainted()
 {
-     argument.beginStructure();
-     argument >> session.session_id
-        >> session.user_id
-        >> session.user_name
-        >> session.seat_id
-        >> session.session_path;
-     argument.endStructure();
-     return argument;
+  // Bring the visible tab online first, then prefetch the others one per
+  // event loop iteration, so the window stays responsive in between
+
+  if (!setupDone)
+    return;
+
+  qDebug() << "Shown and painted after" << startupClock.elapsed() << "ms";
+  initTab(ui.tabWidget->currentWidget());
+
+  // The timer list needs the unfiltered unit lists, it is left until shown
+  prefetchTabs << ui.tabUnits << ui.tabUserUnits << ui.tabSessions
+               << ui.tabJobs << ui.tabConf;
+  QTimer::singleShot(0, this, SLOT(slotPrefetchNextTab()));
+}
+
+void kcmsystemd::slotPrefetchNextTab()
+{
+  while (!prefetchTabs.isEmpty())
+  {
+    QWidget *tab = prefetchTabs.takeFirst();
+    if (initializedTabs.contains(tab))
+      continue;
+    initTab(tab);
+    QTimer::singleShot(0, this, SLOT(slotPrefetchNextTab()));
+    return;
+  }
+  qDebug() << "All tabs initialized after" << startupClock.elapsed() << "ms";
+}
+
+void kcmsystemd::slotTabChanged(int index)
+{
+  initTab(ui.tabWidget->widget(index));
+}
+
+void kcmsystemd::initTab(QWidget *tab)
+{
+  // Initializes a tab the first time it is needed. Nothing is set up
+  // when systemd was not found.
+
+  if (!setupDone || !tab || initializedTabs.contains(tab))
+    return;
+  initializedTabs.insert(tab);
+
+  QElapsedTimer phaseClock;
+  phaseClock.start();
+
+  if (tab == ui.tabUnits)
+  {
+    // Use kf5-config to get kde prefix
+    kdeConfig = new QProcess(this);
+    connect(kdeConfig, SIGNAL(readyReadStandardOutput()), this, SLOT(slotKdeConfig()));
+    kdeConfig->start("kf5-config", QStringList() << "--prefix");
+
+    // Subscribe to dbus signals from systemd system daemon and connect them to slots
+    systembus.connect(connSystemd, pathSysdMgr, ifaceMgr, "Reloading", this, SLOT(slotSystemSystemdReloading(bool)));
+    // systembus.connect(connSystemd, pathSysdMgr, ifaceMgr, "UnitNew", this, SLOT(slotUnitLoaded(QString, QDBusObjectPath)));
+    // systembus.connect(connSystemd,pathSysdMgr, ifaceMgr, "UnitRemoved", this, SLOT(slotUnitUnloaded(QString, QDBusObjectPath)));
+    systembus.connect(connSystemd, pathSysdMgr, ifaceMgr, "UnitFilesChanged", this, SLOT(slotSystemUnitsChanged()));
+    systembus.connect(connSystemd, pathSysdMgr, ifaceMgr, "UnitFilesChanged", metadataCache, SLOT(slotUnitFilesChanged()));
+    systembus.connect(connSystemd, "", ifaceDbusProp, "PropertiesChanged", this, SLOT(slotSystemUnitPropertiesChanged(QString, QVariantMap, QStringList, QDBusMessage)));
+    // Track the job queue. Stopping units does not emit PropertiesChanged, so
+    // the unit of a finished job is updated from JobRemoved.
+    systembus.connect(connSystemd, pathSysdMgr, ifaceMgr, "JobNew", this, SLOT(slotSystemJobNew(uint, QDBusObjectPath, QString)));
+    systembus.connect(connSystemd, pathSysdMgr, ifaceMgr, "JobRemoved", this, SLOT(slotSystemJobRemoved(uint, QDBusObjectPath, QString, QString)));
+
+    QMetaObject::invokeMethod(systemFetcher, "subscribe", Qt::QueuedConnection);
+    slotRefreshUnitsList(sys);
+    logStartupPhase("system bus signals", phaseClock);
+  }
+  else if (tab == ui.tabUserUnits)
+  {
+    if (!enableUserUnits)
+      return;
+
+    // Subscribe to dbus signals from systemd user daemon and connect them to slots
+    QDBusConnection userbus = QDBusConnection::connectToBus(userBusPath, connSystemd);
+    userbus.connect(connSystemd, pathSysdMgr, ifaceMgr, "Reloading", this, SLOT(slotUserSystemdReloading(bool)));
+    userbus.connect(connSystemd, pathSysdMgr, ifaceMgr, "UnitFilesChanged", this, SLOT(slotUserUnitsChanged()));
+    userbus.connect(connSystemd, pathSysdMgr, ifaceMgr, "UnitFilesChanged", metadataCache, SLOT(slotUnitFilesChanged()));
+    userbus.connect(connSystemd, "", ifaceDbusProp, "PropertiesChanged", this, SLOT(slotUserUnitPropertiesChanged(QString, QVariantMap, QStringList, QDBusMessage)));
+    userbus.connect(connSystemd, pathSysdMgr, ifaceMgr, "JobNew", this, SLOT(slotUserJobNew(uint, QDBusObjectPath, QString)));
+    userbus.connect(connSystemd, pathSysdMgr, ifaceMgr, "JobRemoved", this, SLOT(slotUserJobRemoved(uint, QDBusObjectPath, QString, QString)));
+
+    QMetaObject::invokeMethod(userFetcher, "subscribe", Qt::QueuedConnection);
+    slotRefreshUnitsList(user);
+    logStartupPhase("user bus signals", phaseClock);
+  }
+  else if (tab == ui.tabConf)
+  {
+    setupConf();
+    logStartupPhase("configuration", phaseClock);
+  }
+  else if (tab == ui.tabSessions || tab == ui.tabLogindUsers || tab == ui.tabSeats)
+  {
+    // The three tabs share one snapshot
+    initializedTabs << ui.tabSessions << ui.tabLogindUsers << ui.tabSeats;
+    setupLogindLists();
+    systembus.connect(connLogind, "", ifaceDbusProp, "PropertiesChanged", this, SLOT(slotLogindPropertiesChanged(QString, QVariantMap, QStringList, QDBusMessage)));
+    logStartupPhase("logind", phaseClock);
+  }
+  else if (tab == ui.tabTimers)
+  {
+    // Timers are looked up in the unit lists, and refreshed with them
+    initTab(ui.tabUnits);
+    initTab(ui.tabUserUnits);
+    updateServerFilter(sys);
+    updateServerFilter(user);
+    phaseClock.restart();
+    setupTimerlist();
+    logStartupPhase("timers", phaseClock);
+  }
+  else if (tab == ui.tabJobs)
+  {
+    loadJobList();
+    logStartupPhase("jobs", phaseClock);
+  }
+  else if (tab == ui.tabBoot)
+    loadBootAnalysis();
 }
 
 void kcmsystemd::setupSignalSlots()
@@ -231,18 +336,26 @@ void kcmsystemd::setupSignalSlots()
 
 void kcmsystemd::load()
 {
+  if (!setupDone)
+    return;
+
   // Only populate comboboxes once
   if (timesLoad == 0)
   {
-    QStringList allowUnitTypes = QStringList() << i18n("All") << i18n("Targets") << i18n("Services")
-                                               << i18n("Devices") << i18n("Mounts") << i18n("Automounts") << i18n("Swaps")
-                                               << i18n("Sockets") << i18n("Paths") << i18n("Timers") << i18n("Snapshots")
-                                               << i18n("Slices") << i18n("Scopes");
-    ui.cmbUnitTypes->addItems(allowUnitTypes);
-    ui.cmbUserUnitTypes->addItems(allowUnitTypes);
+    unitTypeNames = QStringList() << i18n("All") << i18n("Targets") << i18n("Services")
+                                  << i18n("Devices") << i18n("Mounts") << i18n("Automounts") << i18n("Swaps")
+                                  << i18n("Sockets") << i18n("Paths") << i18n("Timers") << i18n("Snapshots")
+                                  << i18n("Slices") << i18n("Scopes");
+    ui.cmbUnitTypes->addItems(unitTypeNames);
+    ui.cmbUserUnitTypes->addItems(unitTypeNames);
     ui.cmbConfFile->addItems(listConfFiles);
+    slotUnitFacetsChanged();
   }
   timesLoad = timesLoad + 1;
+
+  // The configuration is read when its tab is initialized
+  if (!initializedTabs.contains(ui.tabConf))
+    return;
   
   // Set all confOptions to default
   // This is needed to clear user changes when resetting the KCM
@@ -258,7 +371,7 @@ void kcmsystemd::load()
   }
 
   // Connect signals to slots, which need to be after initializeInterface()
-  connect(confModel, SIGNAL(dataChanged(const QModelIndex &, const QModelIndex &)), this, SLOT(slotConfChanged(const QModelIndex &, const QModelIndex &)));
+  connect(confModel, SIGNAL(dataChanged(const QModelIndex &, const QModelIndex &)), this, SLOT(slotConfChanged(const QModelIndex &, const QModelIndex &)), Qt::UniqueConnection);
 }
 
 void kcmsystemd::setupConfigParms()
@@ -994,7 +1107,22 @@ void kcmsystemd::readConfFile(int fileindex)
 
 void kcmsystemd::setupConf()
 {
-  // Sets up the configfile model and tableview
+  // Sets up the configuration options, the configfile model and tableview,
+  // and reads the configuration files
+
+  // Use boost to find persistent partition size
+  boost::filesystem::path pp ("/var/log");
+  boost::filesystem::space_info logPpart = boost::filesystem::space(pp);
+  partPersSizeMB = logPpart.capacity / 1024 / 1024;
+  
+  // Use boost to find volatile partition size
+  boost::filesystem::path pv ("/run/log");
+  boost::filesystem::space_info logVpart = boost::filesystem::space(pv);
+  partVolaSizeMB = logVpart.capacity / 1024 / 1024;
+  qDebug() << "Persistent partition size found to: " << partPersSizeMB << "MB";
+  qDebug() << "Volatile partition size found to: " << partVolaSizeMB << "MB";
+
+  setupConfigParms();
 
   confModel = new ConfModel(this);
   proxyModelConf = new QSortFilterProxyModel(this);
@@ -1008,6 +1136,7 @@ void kcmsystemd::setupConf()
   ui.tblConf->setItemDelegate(myDelegate);
 
   ui.tblConf->setColumnHidden(2, true);
+  load();
   ui.tblConf->resizeColumnsToContents();
 }
 
@@ -1020,7 +1149,6 @@ void kcmsystemd::setupUnitslist()
 
   QMap<filterType, QString> filters;
   filters[activeState] = "";
-  filters[unitType] = "";
   filters[unitName] = "";
 
   // QList<SystemdUnit> *ptrUnits;
@@ -1029,51 +1157,159 @@ void kcmsystemd::setupUnitslist()
   // Setup the system unit model
   systemUnitModel = new UnitModel(this, &unitslist);
   systemUnitFilterModel = new SortFilterUnitModel(this);
-  systemUnitFilterModel->setDynamicSortFilter(false);
+  systemUnitFilterModel->setDynamicSortFilter(true);
+  systemUnitFilterModel->setSortRole(Qt::UserRole);
   systemUnitFilterModel->initFilterMap(filters);
   systemUnitFilterModel->setSourceModel(systemUnitModel);
   ui.tblUnits->setModel(systemUnitFilterModel);
+  ui.tblUnits->setItemDelegate(new SparklineDelegate(systemUnitModel->resourceHistory(), this));
   ui.tblUnits->sortByColumn(3, Qt::AscendingOrder);
 
   // Setup the user unit model
   userUnitModel = new UnitModel(this, &userUnitslist, userBusPath);
   userUnitFilterModel = new SortFilterUnitModel(this);
-  userUnitFilterModel->setDynamicSortFilter(false);
+  userUnitFilterModel->setDynamicSortFilter(true);
+  userUnitFilterModel->setSortRole(Qt::UserRole);
   userUnitFilterModel->initFilterMap(filters);
   userUnitFilterModel->setSourceModel(userUnitModel);
   ui.tblUserUnits->setModel(userUnitFilterModel);
+  ui.tblUserUnits->setItemDelegate(new SparklineDelegate(userUnitModel->resourceHistory(), this));
   ui.tblUserUnits->sortByColumn(3, Qt::AscendingOrder);
 
+  // Properties for the extra columns are only fetched for visible rows
+  new UnitPrefetcher(ui.tblUnits, systemUnitModel, systembus, this);
+  if (enableUserUnits)
+    new UnitPrefetcher(ui.tblUserUnits, userUnitModel, QDBusConnection::connectToBus(userBusPath, connSystemd), this);
+
+  // Every property of the selected unit, kept current from PropertiesChanged
+  systemPropertyModel = new UnitPropertyModel(systembus, this);
+  userPropertyModel = new UnitPropertyModel(QDBusConnection::connectToBus(userBusPath, connSystemd), this);
+  ui.tblUnitProperties->setModel(systemPropertyModel);
+  ui.tblUserUnitProperties->setModel(userPropertyModel);
+
+  // Descriptions of units that are not loaded are read from their unit files
+  metadataCache = new UnitMetadataCache(this);
+  systemUnitModel->setMetadataCache(metadataCache);
+  userUnitModel->setMetadataCache(metadataCache);
+
+  connect(systemUnitModel, SIGNAL(facetsChanged()), this, SLOT(slotUnitFacetsChanged()));
+  connect(userUnitModel, SIGNAL(facetsChanged()), this, SLOT(slotUnitFacetsChanged()));
   slotChkShowUnits(-1);
 }
 
-void kcmsystemd::setupSessionlist()
+void kcmsystemd::setupMonitor()
 {
-  // Sets up the session list initially
-
-  // Register the meta type for storing units
-  qDBusRegisterMetaType<SystemdSession>();
-
-  // Setup model for session list
-  sessionModel = new QStandardItemModel(this);
+  // Sets up the cgroup samplers for the resource columns of the unit lists.
+  // Both samplers live in one worker thread.
+
+  qRegisterMetaType<CgroupPathMap>("CgroupPathMap");
+  qRegisterMetaType<CgroupSampleMap>("CgroupSampleMap");
+
+  KConfigGroup cfg(KSharedConfig::openConfig("kcmsystemdrc"), "Monitor");
+  int interval = cfg.readEntry("SampleInterval", 1000);
+
+  monitorThread = new QThread(this);
+  systemSampler = new CgroupSampler();
+  userSampler = new CgroupSampler();
+  foreach (CgroupSampler *sampler, QList<CgroupSampler *>() << systemSampler << userSampler)
+  {
+    sampler->setInterval(interval);
+    sampler->moveToThread(monitorThread);
+    connect(monitorThread, SIGNAL(started()), sampler, SLOT(start()));
+    connect(monitorThread, SIGNAL(finished()), sampler, SLOT(deleteLater()));
+  }
+  connect(systemSampler, SIGNAL(samplesReady(CgroupSampleMap)), systemUnitModel, SLOT(slotSamplesReady(CgroupSampleMap)));
+  connect(userSampler, SIGNAL(samplesReady(CgroupSampleMap)), userUnitModel, SLOT(slotSamplesReady(CgroupSampleMap)));
+
+  // Alternative tree views of the units nested under their slices
+  systemSliceModel = new SliceTreeModel(this);
+  ui.treeUnits->setModel(systemSliceModel);
+  userSliceModel = new SliceTreeModel(this);
+  ui.treeUserUnits->setModel(userSliceModel);
+  connect(systemSampler, SIGNAL(samplesReady(CgroupSampleMap)), systemSliceModel, SLOT(slotSamplesReady(CgroupSampleMap)));
+  connect(userSampler, SIGNAL(samplesReady(CgroupSampleMap)), userSliceModel, SLOT(slotSamplesReady(CgroupSampleMap)));
+  connect(ui.chkSliceTree, SIGNAL(stateChanged(int)), this, SLOT(slotChkSliceTree(int)));
+  connect(ui.chkUserSliceTree, SIGNAL(stateChanged(int)), this, SLOT(slotChkSliceTree(int)));
+
+  // Processes of the selected unit, shown below the unit lists
+  qRegisterMetaType<ProcessInfoList>("ProcessInfoList");
+  qRegisterMetaType<QList<int> >("QList<int>");
+  systemProcSampler = new ProcessSampler();
+  userProcSampler = new ProcessSampler();
+  systemProcessModel = new ProcessModel(this);
+  userProcessModel = new ProcessModel(this);
+  QList<ProcessSampler *> procSamplers = QList<ProcessSampler *>() << systemProcSampler << userProcSampler;
+  QList<ProcessModel *> procModels = QList<ProcessModel *>() << systemProcessModel << userProcessModel;
+  QList<QTableView *> procViews = QList<QTableView *>() << ui.tblProcesses << ui.tblUserProcesses;
+  for (int i = 0; i < procSamplers.size(); ++i)
+  {
+    procSamplers.at(i)->setInterval(interval);
+    procSamplers.at(i)->moveToThread(monitorThread);
+    connect(monitorThread, SIGNAL(started()), procSamplers.at(i), SLOT(start()));
+    connect(monitorThread, SIGNAL(finished()), procSamplers.at(i), SLOT(deleteLater()));
+    connect(procSamplers.at(i), SIGNAL(processesCleared()), procModels.at(i), SLOT(slotProcessesCleared()));
+    connect(procSamplers.at(i), SIGNAL(processesChanged(ProcessInfoList, QList<int>)),
+            procModels.at(i), SLOT(slotProcessesChanged(ProcessInfoList, QList<int>)));
+
+    QSortFilterProxyModel *proxyModel = new QSortFilterProxyModel(this);
+    proxyModel->setSourceModel(procModels.at(i));
+    proxyModel->setSortRole(Qt::UserRole);
+    proxyModel->setDynamicSortFilter(true);
+    procViews.at(i)->setModel(proxyModel);
+    procViews.at(i)->sortByColumn(1, Qt::DescendingOrder);
+  }
+  connect(ui.tblUnits->selectionModel(), SIGNAL(currentRowChanged(QModelIndex, QModelIndex)), this, SLOT(slotUnitSelected(QModelIndex)));
+  connect(ui.tblUserUnits->selectionModel(), SIGNAL(currentRowChanged(QModelIndex, QModelIndex)), this, SLOT(slotUnitSelected(QModelIndex)));
+
+  // Only units that are visible, or all displayed units when sorting on a
+  // resource column, are sampled. Collect them shortly after the view changed.
+  monitorTimer = new QTimer(this);
+  monitorTimer->setSingleShot(true);
+  monitorTimer->setInterval(100);
+  connect(monitorTimer, SIGNAL(timeout()), this, SLOT(slotUpdateMonitoredUnits()));
+  foreach (QTableView *tblView, QList<QTableView *>() << ui.tblUnits << ui.tblUserUnits)
+  {
+    connect(tblView->verticalScrollBar(), SIGNAL(valueChanged(int)), monitorTimer, SLOT(start()));
+    connect(tblView->horizontalHeader(), SIGNAL(sortIndicatorChanged(int, Qt::SortOrder)), monitorTimer, SLOT(start()));
+    connect(tblView->model(), SIGNAL(layoutChanged()), monitorTimer, SLOT(start()));
+    connect(tblView->model(), SIGNAL(modelReset()), monitorTimer, SLOT(start()));
+  }
+
+  monitorThread->start();
+  monitorTimer->start();
+}
 
-  // Install eventfilter to capture mouse move events
-  ui.tblSessions->viewport()->installEventFilter(this);
+void kcmsystemd::setupLogindLists()
+{
+  // Sets up the session, user and seat lists initially. All three are
+  // views of one logind snapshot.
 
-  // Set header row
-  sessionModel->setHorizontalHeaderItem(0, new QStandardItem(i18n("Session ID")));
-  sessionModel->setHorizontalHeaderItem(1, new QStandardItem(i18n("Session Object Path"))); // This column is hidden
-  sessionModel->setHorizontalHeaderItem(2, new QStandardItem(i18n("State")));
-  sessionModel->setHorizontalHeaderItem(3, new QStandardItem(i18n("User ID")));
-  sessionModel->setHorizontalHeaderItem(4, new QStandardItem(i18n("User Name")));
-  sessionModel->setHorizontalHeaderItem(5, new QStandardItem(i18n("Seat ID")));
+  logindSnapshot = new LogindSnapshot(this);
 
-  // Set model for QTableView (should be called after headers are set)
+  // Setup models for the lists. Tooltips are built by the models from the
+  // cached properties when the view asks for them.
+  sessionModel = new SessionModel(logindSnapshot, this);
   ui.tblSessions->setModel(sessionModel);
   ui.tblSessions->setColumnHidden(1, true);
 
-  // Add all the sessions
-  slotRefreshSessionList();
+  logindUserModel = new LogindUserModel(logindSnapshot, this);
+  ui.tblLogindUsers->setModel(logindUserModel);
+
+  seatModel = new SeatModel(logindSnapshot, this);
+  ui.tblSeats->setModel(seatModel);
+
+  // Keep the snapshot up to date with objects coming and going
+  systembus.connect(connLogind, pathLogdMgr, ifaceLogdMgr, "SessionNew", logindSnapshot, SLOT(slotSessionNew(QString, QDBusObjectPath)));
+  systembus.connect(connLogind, pathLogdMgr, ifaceLogdMgr, "SessionRemoved", logindSnapshot, SLOT(slotSessionRemoved(QString, QDBusObjectPath)));
+  systembus.connect(connLogind, pathLogdMgr, ifaceLogdMgr, "UserNew", logindSnapshot, SLOT(slotUserNew(uint, QDBusObjectPath)));
+  systembus.connect(connLogind, pathLogdMgr, ifaceLogdMgr, "UserRemoved", logindSnapshot, SLOT(slotUserRemoved(uint, QDBusObjectPath)));
+  systembus.connect(connLogind, pathLogdMgr, ifaceLogdMgr, "SeatNew", logindSnapshot, SLOT(slotSeatNew(QString, QDBusObjectPath)));
+  systembus.connect(connLogind, pathLogdMgr, ifaceLogdMgr, "SeatRemoved", logindSnapshot, SLOT(slotSeatRemoved(QString, QDBusObjectPath)));
+
+  // Show the objects from the last snapshot, then load all sessions, users
+  // and seats in one batch
+  logindSnapshot->restoreState(snapshot.logindState);
+  logindSnapshot->refresh();
 }
 
 void kcmsystemd::setupTimerlist()
@@ -1104,11 +1340,31 @@ void kcmsystemd::setupTimerlist()
   connect(timer, SIGNAL(timeout()), this, SLOT(slotUpdateTimers()));
   timer->start(1000);
 
-  slotRefreshTimerList();
+  // Until the unit lists are live, show the timers from the last snapshot
+  if (systemUnitModel->isStale())
+  {
+    foreach (const TimerRow &row, snapshot.timers)
+    {
+      QStandardItem *id = new QStandardItem(row.timer);
+      id->setData(QIcon::fromTheme(row.bus == sys ? "object-locked" : "user-identity"), Qt::DecorationRole);
+      id->setData(row.bus, Qt::UserRole);
+      timerModel->appendRow(QList<QStandardItem *>() << id
+                                                      << new QStandardItem(row.next)
+                                                      << new QStandardItem("")
+                                                      << new QStandardItem(row.last)
+                                                      << new QStandardItem("")
+                                                      << new QStandardItem(row.activates));
+    }
+  }
+  else
+    slotRefreshTimerList();
 }
 
 void kcmsystemd::defaults()
 {
+  if (!setupDone)
+    return;
+  initTab(ui.tabConf);
   if (KMessageBox::warningYesNo(this, i18n("Load default settings for all files?")) == KMessageBox::Yes)
   { 
     //defaults for system.conf
@@ -1122,6 +1378,11 @@ void kcmsystemd::defaults()
 
 void kcmsystemd::save()
 {  
+  // Never write files from options that were not read
+  if (!setupDone)
+    return;
+  initTab(ui.tabConf);
+
   QString systemConfFileContents;
   systemConfFileContents.append("# " + etcDir + "/system.conf\n# Generated by kcmsystemd control module v" + KCM_SYSTEMD_VERSION + ".\n");
   systemConfFileContents.append("[Manager]\n");
@@ -1224,9 +1485,7 @@ void kcmsystemd::slotChkShowUnits(int state)
       ui.chkUnloadedUnits->setEnabled(false);
       systemUnitFilterModel->addFilterRegExp(activeState, "^(active)");
     }
-    systemUnitFilterModel->invalidate();
-    ui.tblUnits->sortByColumn(ui.tblUnits->horizontalHeader()->sortIndicatorSection(),
-                              ui.tblUnits->horizontalHeader()->sortIndicatorOrder());
+    updateServerFilter(sys);
   }
   if (state == -1 ||
       QObject::sender()->objectName() == "chkInactiveUserUnits" ||
@@ -1246,9 +1505,7 @@ void kcmsystemd::slotChkShowUnits(int state)
       ui.chkUnloadedUserUnits->setEnabled(false);
       userUnitFilterModel->addFilterRegExp(activeState, "^(active)");
     }
-    userUnitFilterModel->invalidate();
-    ui.tblUserUnits->sortByColumn(ui.tblUserUnits->horizontalHeader()->sortIndicatorSection(),
-                                  ui.tblUserUnits->horizontalHeader()->sortIndicatorOrder());
+    updateServerFilter(user);
   }
   updateUnitCount();
 }
@@ -1259,153 +1516,414 @@ void kcmsystemd::slotCmbUnitTypes(int index)
 
   if (QObject::sender()->objectName() == "cmbUnitTypes")
   {
-    systemUnitFilterModel->addFilterRegExp(unitType, "(" + unitTypeSufx.at(index) + ")$");
-    systemUnitFilterModel->invalidate();
-    ui.tblUnits->sortByColumn(ui.tblUnits->horizontalHeader()->sortIndicatorSection(),
-                              ui.tblUnits->horizontalHeader()->sortIndicatorOrder());
+    systemUnitFilterModel->setUnitTypeFilter(index);
+    updateServerFilter(sys);
   }
   else if (QObject::sender()->objectName() == "cmbUserUnitTypes")
   {
-    userUnitFilterModel->addFilterRegExp(unitType, "(" + unitTypeSufx.at(index) + ")$");
-    userUnitFilterModel->invalidate();
-    ui.tblUserUnits->sortByColumn(ui.tblUserUnits->horizontalHeader()->sortIndicatorSection(),
-                                  ui.tblUserUnits->horizontalHeader()->sortIndicatorOrder());
+    userUnitFilterModel->setUnitTypeFilter(index);
+    updateServerFilter(user);
   }
   updateUnitCount();
 }
 
-void kcmsystemd::slotRefreshUnitsList(bool initial, dbusBus bus)
+void kcmsystemd::updateServerFilter(dbusBus bus)
 {
-  // Updates the unit lists
+  // Lets the manager filter the unit list when only active units or one
+  // unit type are shown. The view keeps filtering as well, for managers
+  // without the filtered list methods. The timer list and the dependency
+  // graph need all units, so nothing is filtered while they are in use.
 
-  if (bus == sys)
+  UnitListFetcher *fetcher = (bus == user) ? userFetcher : systemFetcher;
+  if (!fetcher)
+    return;
+
+  QStringList states, patterns;
+  bool needAllUnits = initializedTabs.contains(ui.tabTimers) || (bus == user ? userGraph : systemGraph);
+  if (!needAllUnits)
   {
-    qDebug() << "Refreshing system units...";
+    QCheckBox *chkInactive = (bus == user) ? ui.chkInactiveUserUnits : ui.chkInactiveUnits;
+    QComboBox *cmbTypes = (bus == user) ? ui.cmbUserUnitTypes : ui.cmbUnitTypes;
+    if (!chkInactive->isChecked())
+      states << "active";
+    if (cmbTypes->currentIndex() > 0)
+      patterns << "*" + unitTypeSufx.at(cmbTypes->currentIndex());
+  }
+  if (states == serverStates.value(bus) && patterns == serverPatterns.value(bus))
+    return;
 
-    // get an updated list of system units via dbus
-    unitslist.clear();
-    unitslist = getUnitsFromDbus(sys);
-    noActSystemUnits = 0;
-    foreach (SystemdUnit unit, unitslist)
-    {
-      if (unit.active_state == "active")
-        noActSystemUnits++;
-    }
-    if (!initial)
+  serverStates[bus] = states;
+  serverPatterns[bus] = patterns;
+  QMetaObject::invokeMethod(fetcher, "setFilter", Qt::QueuedConnection,
+                            Q_ARG(QStringList, states), Q_ARG(QStringList, patterns));
+  if (initializedTabs.contains(bus == user ? ui.tabUserUnits : ui.tabUnits))
+    slotRefreshUnitsList(bus);
+  slotUnitFacetsChanged();
+}
+
+bool kcmsystemd::isServerFiltered(dbusBus bus) const
+{
+  return !serverStates.value(bus).isEmpty() || !serverPatterns.value(bus).isEmpty();
+}
+
+bool kcmsystemd::serverFilterExcludes(const QString &unit, const QString &result, dbusBus bus) const
+{
+  // Whether a unit missing from a filtered list was left out by the
+  // manager. Units of other types never show. When only active units are
+  // listed, a unit can only have become active through a job that
+  // succeeded.
+
+  const QStringList patterns = serverPatterns.value(bus);
+  if (!patterns.isEmpty())
+  {
+    bool matched = false;
+    foreach (const QString &pattern, patterns)
+      matched |= QRegExp(pattern, Qt::CaseSensitive, QRegExp::Wildcard).exactMatch(unit);
+    if (!matched)
+      return true;
+  }
+  return !serverStates.value(bus).isEmpty() && result != "done";
+}
+
+void kcmsystemd::setupJobList()
+{
+  // Sets up the job list. It is fed by the JobNew and JobRemoved signals.
+
+  jobModel = new JobModel(this);
+  QSortFilterProxyModel *proxyModel = new QSortFilterProxyModel(this);
+  proxyModel->setSourceModel(jobModel);
+  proxyModel->setSortRole(Qt::UserRole);
+  proxyModel->setDynamicSortFilter(true);
+  ui.tblJobs->horizontalHeader()->setDefaultAlignment(Qt::AlignLeft | Qt::AlignVCenter);
+  ui.tblJobs->setModel(proxyModel);
+  ui.tblJobs->sortByColumn(0, Qt::DescendingOrder);
+  connect(jobModel, SIGNAL(statsChanged()), this, SLOT(slotJobStatsChanged()));
+}
+
+void kcmsystemd::loadJobList()
+{
+  // Adds the jobs that were queued before the signals were connected
+
+  QList<dbusBus> buses = QList<dbusBus>() << sys;
+  if (enableUserUnits)
+    buses << user;
+  foreach (dbusBus bus, buses)
+  {
+    QDBusMessage dbusreply = callDbusMethod("ListJobs", sysdMgr, bus);
+    if (dbusreply.type() != QDBusMessage::ReplyMessage || dbusreply.arguments().isEmpty())
+      continue;
+
+    const QDBusArgument argJobs = dbusreply.arguments().at(0).value<QDBusArgument>();
+    argJobs.beginArray();
+    while (!argJobs.atEnd())
     {
-      systemUnitModel->dataChanged(systemUnitModel->index(0, 0), systemUnitModel->index(systemUnitModel->rowCount(), 3));
-      systemUnitFilterModel->invalidate();
-      updateUnitCount();
-      slotRefreshTimerList();
+      uint id;
+      QString unit, type, state;
+      QDBusObjectPath jobPath, unitPath;
+      argJobs.beginStructure();
+      argJobs >> id >> unit >> type >> state >> jobPath >> unitPath;
+      argJobs.endStructure();
+      jobModel->jobNew(id, unit, type, bus);
     }
+    argJobs.endArray();
   }
+  slotJobStatsChanged();
+}
+
+void kcmsystemd::setupBootAnalysis()
+{
+  // Sets up the boot tab. The data is only fetched when the tab is shown.
+
+  blameModel = new QStandardItemModel(this);
+  blameModel->setHorizontalHeaderItem(0, new QStandardItem(i18n("Unit")));
+  blameModel->setHorizontalHeaderItem(1, new QStandardItem(i18n("Activation time")));
+  blameModel->setSortRole(Qt::UserRole);
+  ui.tblBlame->horizontalHeader()->setDefaultAlignment(Qt::AlignLeft | Qt::AlignVCenter);
+  ui.tblBlame->setModel(blameModel);
+
+  bootChart = new BootChart();
+  ui.scrollBootChart->setWidget(bootChart);
+
+  // Latencies across boots, scanned from the journal
+  bootHistory = new BootHistory(this);
+  QSortFilterProxyModel *historyProxy = new QSortFilterProxyModel(this);
+  historyProxy->setSourceModel(new BootHistoryModel(bootHistory, this));
+  historyProxy->setSortRole(Qt::UserRole);
+  ui.tblBootHistory->horizontalHeader()->setDefaultAlignment(Qt::AlignLeft | Qt::AlignVCenter);
+  ui.tblBootHistory->setModel(historyProxy);
+  ui.tblBootHistory->setItemDelegateForColumn(5, new LatencyTrendDelegate(this));
+  ui.tblBootHistory->sortByColumn(4, Qt::DescendingOrder);
+
+}
 
-  else if (enableUserUnits && bus == user)
+void kcmsystemd::loadBootAnalysis()
+{
+  // The unit timestamps come with the sweep that builds the dependency
+  // graph, the boot timestamps from one GetAll on the Manager
+
+  ui.lblBootTime->setText(i18n("Loading boot data..."));
+  bootHistory->refresh();
+
+  DependencyGraph *graph = dependencyGraph(sys);
+  connect(graph, SIGNAL(graphChanged()), this, SLOT(slotFillBootAnalysis()), Qt::UniqueConnection);
+
+  QDBusMessage msg = QDBusMessage::createMethodCall(connSystemd, pathSysdMgr, ifaceDbusProp, "GetAll");
+  msg << ifaceMgr;
+  QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(systembus.asyncCall(msg), this);
+  connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(slotBootTimestampsFetched(QDBusPendingCallWatcher*)));
+}
+
+void kcmsystemd::slotBootTimestampsFetched(QDBusPendingCallWatcher *watcher)
+{
+  QDBusPendingReply<QVariantMap> reply = *watcher;
+  watcher->deleteLater();
+
+  if (reply.isError())
   {
-    qDebug() << "Refreshing user units...";
+    ui.lblBootTime->setText(i18n("Failed to get the boot timestamps: %1", reply.error().message()));
+    return;
+  }
+  bootTimestamps = reply.value();
+  slotFillBootAnalysis();
+}
+
+static QString formatUsec(quint64 usec)
+{
+  // Same format as systemd-analyze
+  if (usec >= 1000000)
+    return QString::number(usec / 1000000.0, 'f', 3) + "s";
+  return QString::number(usec / 1000) + "ms";
+}
+
+void kcmsystemd::slotFillBootAnalysis()
+{
+  DependencyGraph *graph = dependencyGraph(sys);
+  if (!graph->isReady() || bootTimestamps.isEmpty())
+    return;
 
-    // get an updated list of user units via dbus
-    userUnitslist.clear();
-    userUnitslist = getUnitsFromDbus(user);
-    noActUserUnits = 0;
-    foreach (SystemdUnit unit, userUnitslist)
+  // Overall boot time, split up like systemd-analyze does
+  quint64 firmware = bootTimestamps.value("FirmwareTimestampMonotonic").toULongLong();
+  quint64 loader = bootTimestamps.value("LoaderTimestampMonotonic").toULongLong();
+  quint64 initrd = bootTimestamps.value("InitRDTimestampMonotonic").toULongLong();
+  quint64 userspace = bootTimestamps.value("UserspaceTimestampMonotonic").toULongLong();
+  quint64 finish = bootTimestamps.value("FinishTimestampMonotonic").toULongLong();
+  if (finish == 0)
+    ui.lblBootTime->setText(i18n("Bootup is not yet finished."));
+  else
+  {
+    QStringList parts;
+    if (firmware > loader)
+      parts << i18n("%1 (firmware)", formatUsec(firmware - loader));
+    if (loader > 0)
+      parts << i18n("%1 (loader)", formatUsec(loader));
+    parts << i18n("%1 (kernel)", formatUsec(initrd > 0 ? initrd : userspace));
+    if (initrd > 0)
+      parts << i18n("%1 (initrd)", formatUsec(userspace - initrd));
+    parts << i18n("%1 (userspace)", formatUsec(finish - userspace));
+    ui.lblBootTime->setText(i18n("Startup finished in %1 = %2", parts.join(" + "),
+                                 formatUsec((firmware > loader ? firmware : loader) + finish)));
+  }
+
+  // Blame and timeline from the activation timestamps of the units
+  blameModel->removeRows(0, blameModel->rowCount());
+  QList<BootChart::Bar> bars;
+  foreach (const QString &unit, graph->loadedUnits())
+  {
+    UnitTimes t = graph->unitTimes(unit);
+    if (t.activating == 0)
+      continue;
+
+    if (t.activated > t.activating)
     {
-      if (unit.active_state == "active")
-        noActUserUnits++;
+      QStandardItem *name = new QStandardItem(unit);
+      name->setData(unit, Qt::UserRole);
+      QStandardItem *time = new QStandardItem(formatUsec(t.activated - t.activating));
+      time->setData(t.activated - t.activating, Qt::UserRole);
+      blameModel->appendRow(QList<QStandardItem *>() << name << time);
     }
-    if (!initial)
+
+    if (finish == 0 || t.activating <= finish)
     {
-      userUnitModel->dataChanged(userUnitModel->index(0, 0), userUnitModel->index(userUnitModel->rowCount(), 3));
-      userUnitFilterModel->invalidate();
-      updateUnitCount();
-      slotRefreshTimerList();
+      BootChart::Bar bar;
+      bar.unit = unit;
+      bar.activating = t.activating;
+      bar.activated = t.activated;
+      bars << bar;
     }
   }
+  ui.tblBlame->sortByColumn(1, Qt::DescendingOrder);
+  ui.tblBlame->resizeColumnsToContents();
+  bootChart->setBars(bars, userspace, finish);
+
+  // Critical chain of the default target, each unit nested under the unit
+  // that waited for it
+  ui.treeCriticalChain->clear();
+  QString target = callDbusMethod("GetDefaultTarget", sysdMgr).arguments().value(0).toString();
+  if (target.isEmpty())
+    target = "default.target";
+  QTreeWidgetItem *parent = 0;
+  foreach (const QString &unit, graph->criticalChain(target))
+  {
+    UnitTimes t = graph->unitTimes(unit);
+    QStringList columns;
+    columns << unit
+            << (t.activated ? "@" + formatUsec(t.activated) : QString())
+            << (t.activated > t.activating && t.activating ? "+" + formatUsec(t.activated - t.activating) : QString());
+    QTreeWidgetItem *item = parent ? new QTreeWidgetItem(parent, columns) : new QTreeWidgetItem(ui.treeCriticalChain, columns);
+    if (!columns.at(2).isEmpty())
+      item->setForeground(0, QBrush(Qt::red));
+    parent = item;
+  }
+  ui.treeCriticalChain->expandAll();
+  ui.treeCriticalChain->resizeColumnToContents(0);
+}
+
+void kcmsystemd::setupUnitFetchers()
+{
+  // The units of each bus are listed by a fetcher in its own worker thread
+
+  qRegisterMetaType<QList<SystemdUnit> >("QList<SystemdUnit>");
+  systemFetchThread = new QThread(this);
+  systemFetcher = new UnitListFetcher(systembus, sys);
+  QList<UnitListFetcher *> fetchers = QList<UnitListFetcher *>() << systemFetcher;
+  QList<QThread *> threads = QList<QThread *>() << systemFetchThread;
+  if (enableUserUnits)
+  {
+    userFetchThread = new QThread(this);
+    userFetcher = new UnitListFetcher(QDBusConnection::connectToBus(userBusPath, connSystemd), user);
+    fetchers << userFetcher;
+    threads << userFetchThread;
+  }
+  for (int i = 0; i < fetchers.size(); ++i)
+  {
+    fetchers.at(i)->moveToThread(threads.at(i));
+    connect(threads.at(i), SIGNAL(finished()), fetchers.at(i), SLOT(deleteLater()));
+    connect(fetchers.at(i), SIGNAL(unitsFetched(QList<SystemdUnit>, int)), this, SLOT(slotUnitsFetched(QList<SystemdUnit>, int)));
+    connect(fetchers.at(i), SIGNAL(fetchFailed(int)), this, SLOT(slotUnitsFetchFailed(int)));
+    threads.at(i)->start();
+  }
+  updateServerFilter(sys);
+  updateServerFilter(user);
 }
 
-void kcmsystemd::slotRefreshSessionList()
+void kcmsystemd::restoreSnapshot()
 {
-  // Updates the session list
-  qDebug() << "Refreshing session list...";
+  // Shows the lists from when the module was last closed until the
+  // managers have answered
 
-  // clear list
-  sessionlist.clear();
+  snapshot = SnapshotCache::load();
+  if (!snapshot.valid)
+    return;
 
-  // get an updated list of sessions via dbus
-  QDBusMessage dbusreply = callDbusMethod("ListSessions", logdMgr);
+  systemUnitModel->updateUnits(snapshot.systemUnits);
+  systemUnitModel->setStale(true);
 
-  // extract the list of sessions from the reply
-  const QDBusArgument arg = dbusreply.arguments().at(0).value<QDBusArgument>();
-  if (arg.currentType() == QDBusArgument::ArrayType)
+  if (enableUserUnits)
   {
-    arg.beginArray();
-    while (!arg.atEnd())
-    {
-      SystemdSession session;
-      arg >> session;
-      sessionlist.append(session);
-    }
-    arg.endArray();
+    userUnitModel->updateUnits(snapshot.userUnits);
+    userUnitModel->setStale(true);
   }
+}
 
-  // Iterate through the new list and compare to model
-  for (int i = 0;  i < sessionlist.size(); ++i)
-  {
-    // This is needed to get the "State" property
+void kcmsystemd::saveSnapshot()
+{
+  // Only the lists that were brought up to date replace the ones in the
+  // snapshot
+
+  if (!systemFetcher)
+    return;
 
-    QList<QStandardItem *> items = sessionModel->findItems(sessionlist.at(i).session_id, Qt::MatchExactly, 0);
+  // A list filtered by the manager is not complete
+  if (!systemUnitModel->isStale() && !unitslist.isEmpty() && !isServerFiltered(sys))
+    snapshot.systemUnits = unitslist;
+  if (enableUserUnits && !userUnitModel->isStale() && !userUnitslist.isEmpty() && !isServerFiltered(user))
+    snapshot.userUnits = userUnitslist;
 
-    if (items.isEmpty())
+  if (initializedTabs.contains(ui.tabTimers) && !systemUnitModel->isStale())
+  {
+    snapshot.timers.clear();
+    for (int row = 0; row < timerModel->rowCount(); ++row)
     {
-      // New session discovered so add it to the model
-      QList<QStandardItem *> row;
-      row <<
-      new QStandardItem(sessionlist.at(i).session_id) <<
-      new QStandardItem(sessionlist.at(i).session_path.path()) <<
-      new QStandardItem(getDbusProperty("State", logdSession, sessionlist.at(i).session_path).toString()) <<
-      new QStandardItem(QString::number(sessionlist.at(i).user_id)) <<
-      new QStandardItem(sessionlist.at(i).user_name) <<
-      new QStandardItem(sessionlist.at(i).seat_id);
-      sessionModel->appendRow(row);
-    } else {
-      sessionModel->item(items.at(0)->row(), 2)->setData(getDbusProperty("State", logdSession, sessionlist.at(i).session_path).toString(), Qt::DisplayRole);
+      TimerRow timer;
+      timer.bus = timerModel->item(row, 0)->data(Qt::UserRole).toInt();
+      timer.timer = timerModel->item(row, 0)->text();
+      timer.next = timerModel->item(row, 1)->text();
+      timer.last = timerModel->item(row, 3)->text();
+      timer.activates = timerModel->item(row, 5)->text();
+      snapshot.timers << timer;
     }
   }
 
-  // Check to see if any sessions were removed
-  if (sessionModel->rowCount() != sessionlist.size())
+  if (initializedTabs.contains(ui.tabSessions))
+    snapshot.logindState = logindSnapshot->saveState();
+
+  SnapshotCache::save(snapshot);
+}
+
+void kcmsystemd::slotRefreshUnitsList(dbusBus bus)
+{
+  // Asks the fetcher of the bus for an updated unit list. Requests made
+  // while a fetch is running are folded into one more fetch.
+
+  if (bus == user && !enableUserUnits)
+    return;
+
+  if (fetchesRunning.contains(bus))
   {
-    QList<QPersistentModelIndex> indexes;
-    // Loop through model and compare to retrieved sessionlist
-    for (int row = 0; row < sessionModel->rowCount(); ++row)
-    {
-      SystemdSession session;
-      session.session_id = sessionModel->index(row,0).data().toString();
-      if (!sessionlist.contains(session))
-      {
-        // Add removed units to list for deletion
-        // qDebug() << "Unit removed: " << systemUnitModel->index(row,3).data().toString();
-        indexes << sessionModel->index(row,0);
-      }
-    }
-    // Delete the identified units from model
-    foreach (QPersistentModelIndex i, indexes)
-      sessionModel->removeRow(i.row());
+    fetchesQueued.insert(bus);
+    return;
   }
+  fetchesRunning.insert(bus);
+  QMetaObject::invokeMethod(bus == user ? userFetcher : systemFetcher, "fetch", Qt::QueuedConnection);
+}
 
-  // Update the text color in model
-  QColor newcolor;
-  for (int row = 0; row < sessionModel->rowCount(); ++row)
+void kcmsystemd::slotUnitsFetched(const QList<SystemdUnit> &units, int busIndex)
+{
+  // Updates the unit lists
+
+  dbusBus bus = static_cast<dbusBus>(busIndex);
+  fetchesRunning.remove(bus);
+
+  if (bus == sys)
   {
-    if (sessionModel->data(sessionModel->index(row,2), Qt::DisplayRole) == "active")
-      newcolor = Qt::darkGreen;
-    else if (sessionModel->data(sessionModel->index(row,2), Qt::DisplayRole) == "closing")
-      newcolor = Qt::darkGray;
-    else
-      newcolor = Qt::black;
-    for (int col = 0; col < sessionModel->columnCount(); ++col)
-      sessionModel->setData(sessionModel->index(row,col), QVariant(newcolor), Qt::ForegroundRole);
+    qDebug() << "Refreshing system units...";
+
+    systemUnitModel->updateUnits(units);
+    systemUnitModel->setStale(false);
+    if (ui.chkSliceTree->isChecked())
+      updateSliceTree(sys);
   }
+  else
+  {
+    qDebug() << "Refreshing user units...";
+
+    userUnitModel->updateUnits(units);
+    userUnitModel->setStale(false);
+    if (ui.chkUserSliceTree->isChecked())
+      updateSliceTree(user);
+  }
+  updateUnitCount();
+  if (initializedTabs.contains(ui.tabTimers))
+    slotRefreshTimerList();
+
+  // A reload may change the edges of any unit. A list that is already
+  // outdated by a queued fetch is not worth building from.
+  DependencyGraph *graph = (bus == user) ? userGraph : systemGraph;
+  if (graph && !fetchesQueued.contains(bus) && graphsStale.remove(bus))
+    graph->build(units);
+
+  if (fetchesQueued.remove(bus))
+    slotRefreshUnitsList(bus);
+}
+
+void kcmsystemd::slotUnitsFetchFailed(int busIndex)
+{
+  // The list and its stale flag stay as they are until a fetch succeeds
+
+  dbusBus bus = static_cast<dbusBus>(busIndex);
+  fetchesRunning.remove(bus);
+  if (fetchesQueued.remove(bus))
+    slotRefreshUnitsList(bus);
 }
 
 void kcmsystemd::slotRefreshTimerList()
@@ -1513,6 +2031,7 @@ QList<QStandardItem *> kcmsystemd::buildTimerListRow(const SystemdUnit &unit, co
   // Set icon for id column
   QStandardItem *id = new QStandardItem(unit.id);
   id->setData(icon, Qt::DecorationRole);
+  id->setData(bus, Qt::UserRole);
 
   // Build a row from QStandardItems
   QList<QStandardItem *> row;
@@ -1528,16 +2047,81 @@ QList<QStandardItem *> kcmsystemd::buildTimerListRow(const SystemdUnit &unit, co
 
 void kcmsystemd::updateUnitCount()
 {
-  ui.lblUnitCount->setText(i18n("Total: %1 units, %2 active, %3 displayed",
+  ui.lblUnitCount->setText(i18n("Total: %1 units, %2 active, %3 failed, %4 displayed",
                                 QString::number(systemUnitModel->rowCount()),
-                                QString::number(noActSystemUnits),
+                                QString::number(systemUnitModel->unitCount(facetActiveState, "active")),
+                                QString::number(systemUnitModel->unitCount(facetActiveState, "failed")),
                                 QString::number(systemUnitFilterModel->rowCount())));
-  ui.lblUserUnitCount->setText(i18n("Total: %1 units, %2 active, %3 displayed",
+  ui.lblUserUnitCount->setText(i18n("Total: %1 units, %2 active, %3 failed, %4 displayed",
                                     QString::number(userUnitModel->rowCount()),
-                                    QString::number(noActUserUnits),
+                                    QString::number(userUnitModel->unitCount(facetActiveState, "active")),
+                                    QString::number(userUnitModel->unitCount(facetActiveState, "failed")),
                                     QString::number(userUnitFilterModel->rowCount())));
 }
 
+static QString facetToolTip(const QHash<QString, int> &counts)
+{
+  // One line per state, most common first
+  QList<QPair<int, QString> > states;
+  for (QHash<QString, int>::const_iterator it = counts.constBegin(); it != counts.constEnd(); ++it)
+    states << qMakePair(-it.value(), it.key());
+  std::sort(states.begin(), states.end());
+
+  QStringList lines;
+  for (int i = 0; i < states.size(); ++i)
+    lines << QString("%1 (%2)").arg(states.at(i).second).arg(-states.at(i).first);
+  return lines.join("\n");
+}
+
+void kcmsystemd::slotUnitFacetsChanged()
+{
+  // Shows the number of units per type and state in the filter widgets.
+  // The counts are kept up to date by the models.
+
+  QList<UnitModel *> models = QList<UnitModel *>() << systemUnitModel << userUnitModel;
+  QList<QComboBox *> combos = QList<QComboBox *>() << ui.cmbUnitTypes << ui.cmbUserUnitTypes;
+  QList<QCheckBox *> chkInactive = QList<QCheckBox *>() << ui.chkInactiveUnits << ui.chkInactiveUserUnits;
+  QList<QCheckBox *> chkUnloaded = QList<QCheckBox *>() << ui.chkUnloadedUnits << ui.chkUnloadedUserUnits;
+  QList<dbusBus> buses = QList<dbusBus>() << sys << user;
+  for (int i = 0; i < models.size(); ++i)
+  {
+    const UnitModel *model = models.at(i);
+
+    // Units the manager filtered out are not counted, so only the
+    // selected type is shown with a count then
+    bool filtered = !serverStates.value(buses.at(i)).isEmpty() || !serverPatterns.value(buses.at(i)).isEmpty();
+
+    // The combo boxes are filled in load()
+    if (combos.at(i)->count() == unitTypeNames.size())
+    {
+      for (int type = 0; type < unitTypeSufx.size(); ++type)
+      {
+        int count = (type == 0) ? model->rowCount() : model->unitCount(facetType, unitTypeSufx.at(type));
+        if (filtered && type != combos.at(i)->currentIndex())
+          combos.at(i)->setItemText(type, unitTypeNames.at(type));
+        else
+          combos.at(i)->setItemText(type, i18nc("unit type and number of units", "%1 (%2)", unitTypeNames.at(type), count));
+      }
+    }
+
+    int active = model->unitCount(facetActiveState, "active");
+    int unloaded = model->unitCount(facetLoadState, "unloaded");
+    if (filtered)
+    {
+      chkInactive.at(i)->setText(i18n("Show inactive"));
+      chkUnloaded.at(i)->setText(i18n("Show unloaded"));
+    }
+    else
+    {
+      chkInactive.at(i)->setText(i18n("Show inactive (%1)", model->rowCount() - active - unloaded));
+      chkUnloaded.at(i)->setText(i18n("Show unloaded (%1)", unloaded));
+    }
+    chkInactive.at(i)->setToolTip(facetToolTip(model->unitCounts(facetActiveState)));
+    chkUnloaded.at(i)->setToolTip(facetToolTip(model->unitCounts(facetLoadState)));
+  }
+  updateUnitCount();
+}
+
 void kcmsystemd::authServiceAction(QString service, QString path, QString interface, QString method, QList<QVariant> args)
 {
   // Function to call the helper to authenticate a call to systemd over the system DBus
@@ -1569,6 +2153,104 @@ void kcmsystemd::authServiceAction(QString service, QString path, QString interf
   }
 }
 
+void kcmsystemd::batchUnitAction(const QString &method, const QStringList &units, dbusBus bus)
+{
+  // Applies a method to several units. System units are handled by one
+  // authorized helper call, user units are called directly without
+  // waiting. Jobs are submitted with a bounded number of calls in flight.
+
+  KConfigGroup cfg(KSharedConfig::openConfig("kcmsystemdrc"), "Units");
+  int maxParallel = qMax(1, cfg.readEntry("MaxParallelJobs", 8));
+
+  if (bus == sys)
+  {
+    QVariantMap helperArgs;
+    helperArgs["method"] = method;
+    helperArgs["units"] = units;
+    helperArgs["maxParallel"] = maxParallel;
+
+    Action batchAction("org.kde.kcontrol.kcmsystemd.batchaction");
+    batchAction.setHelperId("org.kde.kcontrol.kcmsystemd");
+    batchAction.setArguments(helperArgs);
+
+    ExecuteJob* job = batchAction.execute();
+    if (!job->exec())
+    {
+      KMessageBox::error(this, i18n("Unable to authenticate/execute the action.\nError code: %1\nError string: %2\nError text: %3", job->error(), job->errorString(), job->errorText()));
+      return;
+    }
+    slotBatchFinished(job->data().value("results").toMap());
+  }
+  else
+  {
+    UnitBatch *batch = new UnitBatch(QDBusConnection::connectToBus(userBusPath, connSystemd), method, units, maxParallel, this);
+    connect(batch, SIGNAL(finished(QVariantMap)), this, SLOT(slotBatchFinished(QVariantMap)));
+    batch->start();
+  }
+}
+
+void kcmsystemd::slotBatchFinished(const QVariantMap &results)
+{
+  // Lists the units the batch action failed for
+
+  QStringList failed;
+  for (QVariantMap::const_iterator it = results.constBegin(); it != results.constEnd(); ++it)
+  {
+    if (!it.value().toString().isEmpty())
+      failed << it.key() + ": " + it.value().toString();
+  }
+  if (!failed.isEmpty())
+    KMessageBox::errorList(this, i18np("The action failed for one unit.", "The action failed for %1 units.", failed.size()), failed);
+}
+
+void kcmsystemd::restartInParallel(const QStringList &units, dbusBus bus)
+{
+  // Asks for the concurrency limit and timeout, then restarts the units and
+  // reports when all restarts have settled
+
+  KConfigGroup cfg(KSharedConfig::openConfig("kcmsystemdrc"), "Units");
+
+  QDialog dlg(this);
+  dlg.setWindowTitle(i18n("Restart units in parallel"));
+  QFormLayout *layout = new QFormLayout(&dlg);
+  QSpinBox *spnInFlight = new QSpinBox(&dlg);
+  spnInFlight->setRange(1, 100);
+  spnInFlight->setValue(cfg.readEntry("RestartMaxInFlight", 8));
+  layout->addRow(i18n("Maximum restarts at a time:"), spnInFlight);
+  QSpinBox *spnTimeout = new QSpinBox(&dlg);
+  spnTimeout->setRange(1, 3600);
+  spnTimeout->setSuffix(" s");
+  spnTimeout->setValue(cfg.readEntry("RestartTimeout", 90));
+  layout->addRow(i18n("Timeout per unit:"), spnTimeout);
+  QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dlg);
+  connect(buttons, SIGNAL(accepted()), &dlg, SLOT(accept()));
+  connect(buttons, SIGNAL(rejected()), &dlg, SLOT(reject()));
+  layout->addRow(buttons);
+  if (dlg.exec() != QDialog::Accepted)
+    return;
+
+  cfg.writeEntry("RestartMaxInFlight", spnInFlight->value());
+  cfg.writeEntry("RestartTimeout", spnTimeout->value());
+
+  RestartOrchestrator *orchestrator = new RestartOrchestrator(units, bus, userBusPath,
+                                                              spnInFlight->value(),
+                                                              spnTimeout->value() * 1000, this);
+  connect(jobModel, SIGNAL(jobFinished(uint, int, QString, QString, qint64)),
+          orchestrator, SLOT(slotJobFinished(uint, int, QString, QString, qint64)));
+  connect(orchestrator, SIGNAL(finished(QStringList, int)), this, SLOT(slotRestartsFinished(QStringList, int)));
+  orchestrator->start();
+}
+
+void kcmsystemd::slotRestartsFinished(const QStringList &summary, int failures)
+{
+  QObject::sender()->deleteLater();
+
+  if (failures > 0)
+    KMessageBox::errorList(this, i18np("One of %2 restarts failed.", "%1 of %2 restarts failed.", failures, summary.size()), summary);
+  else
+    KMessageBox::informationList(this, i18np("The unit was restarted.", "All %1 units were restarted.", summary.size()), summary);
+}
+
 void kcmsystemd::slotUnitContextMenu(const QPoint &pos)
 {
   // Slot for creating the right-click menu in unitlists
@@ -1592,6 +2274,47 @@ void kcmsystemd::slotUnitContextMenu(const QPoint &pos)
     requiresAuth = false;
   }
 
+  // Act on the whole selection when the click is on one of several
+  // selected units
+  QModelIndexList selectedRows = tblView->selectionModel()->selectedRows(3);
+  if (selectedRows.size() > 1 && tblView->selectionModel()->isRowSelected(tblView->indexAt(pos).row(), QModelIndex()))
+  {
+    QStringList units;
+    foreach (const QModelIndex &index, selectedRows)
+      units << index.data().toString();
+
+    QMenu menu(this);
+    QAction *start = menu.addAction(i18np("&Start unit", "&Start %1 units", units.size()));
+    QAction *stop = menu.addAction(i18np("S&top unit", "S&top %1 units", units.size()));
+    QAction *restart = menu.addAction(i18np("&Restart unit", "&Restart %1 units", units.size()));
+    QAction *restartParallel = menu.addAction(i18n("Restart in &parallel..."));
+    menu.addSeparator();
+    QAction *enable = menu.addAction(i18np("En&able unit", "En&able %1 units", units.size()));
+    QAction *disable = menu.addAction(i18np("&Disable unit", "&Disable %1 units", units.size()));
+    menu.addSeparator();
+    QAction *mask = menu.addAction(i18np("&Mask unit", "&Mask %1 units", units.size()));
+    QAction *unmask = menu.addAction(i18np("&Unmask unit", "&Unmask %1 units", units.size()));
+
+    QAction *a = menu.exec(tblView->viewport()->mapToGlobal(pos));
+    if (a == start)
+      batchUnitAction("StartUnit", units, bus);
+    else if (a == stop)
+      batchUnitAction("StopUnit", units, bus);
+    else if (a == restart)
+      batchUnitAction("RestartUnit", units, bus);
+    else if (a == restartParallel)
+      restartInParallel(units, bus);
+    else if (a == enable)
+      batchUnitAction("EnableUnitFiles", units, bus);
+    else if (a == disable)
+      batchUnitAction("DisableUnitFiles", units, bus);
+    else if (a == mask)
+      batchUnitAction("MaskUnitFiles", units, bus);
+    else if (a == unmask)
+      batchUnitAction("UnmaskUnitFiles", units, bus);
+    return;
+  }
+
   // Find name and object path of unit
   QString unit = tblView->model()->index(tblView->indexAt(pos).row(), 3).data().toString();
   QDBusObjectPath pathUnit = list->at(list->indexOf(SystemdUnit(unit))).unit_path;
@@ -1605,6 +2328,7 @@ void kcmsystemd::slotUnitContextMenu(const QPoint &pos)
   menu.addSeparator();
   QAction *edit = menu.addAction(i18n("&Edit unit file"));
   QAction *isolate = menu.addAction(i18n("&Isolate unit"));
+  QAction *dependencies = menu.addAction(i18n("Show de&pendencies"));
   menu.addSeparator();
   QAction *enable = menu.addAction(i18n("En&able unit"));
   QAction *disable = menu.addAction(i18n("&Disable unit"));
@@ -1695,6 +2419,13 @@ void kcmsystemd::slotUnitContextMenu(const QPoint &pos)
 
   QAction *a = menu.exec(tblView->viewport()->mapToGlobal(pos));
    
+  if (a == dependencies)
+  {
+    DependencyDialog *dlg = new DependencyDialog(dependencyGraph(bus), unit, this);
+    dlg->show();
+    return;
+  }
+
   if (a == edit)
   {
     // Find the application associated with text files
@@ -1786,8 +2517,9 @@ void kcmsystemd::slotUnitContextMenu(const QPoint &pos)
   else if (!method.isEmpty())
   {
     // user unit
-    callDbusMethod(method, sysdMgr, bus, argsForCall);
-    if (method == "EnableUnitFiles" || method == "DisableUnitFiles" || method == "MaskUnitFiles" || method == "UnmaskUnitFiles")
+    QDBusMessage reply = callDbusMethod(method, sysdMgr, bus, argsForCall);
+    // Reload only if symlinks actually changed
+    if (isUnitFileMethod(method) && unitFileChangeCount(reply) > 0)
       callDbusMethod("Reload", sysdMgr, bus);
   }
 }
@@ -1808,7 +2540,7 @@ void kcmsystemd::slotSessionContextMenu(const QPoint &pos)
   if (ui.tblSessions->model()->index(ui.tblSessions->indexAt(pos).row(),2).data().toString() == "active")
     activate->setEnabled(false);
 
-  if (getDbusProperty("Type", logdSession, pathSession) == "tty")
+  if (sessionModel->objectProperty(ui.tblSessions->indexAt(pos).row(), "Type") == "tty")
     lock->setEnabled(false);
 
   QAction *a = menu.exec(ui.tblSessions->viewport()->mapToGlobal(pos));
@@ -1835,92 +2567,15 @@ void kcmsystemd::slotSessionContextMenu(const QPoint &pos)
 }
 
 
-bool kcmsystemd::eventFilter(QObject *obj, QEvent* event)
-{
-  // Eventfilter for catching mouse move events over session list
-  // Used for dynamically generating tooltips
-
-  if (event->type() == QEvent::MouseMove && obj->parent()->objectName() == "tblSessions")
-  {
-    // Session list
-    QMouseEvent *me = static_cast<QMouseEvent*>(event);
-    QModelIndex inSessionModel = ui.tblSessions->indexAt(me->pos());
-    if (!inSessionModel.isValid())
-      return false;
-
-    if (sessionModel->itemFromIndex(inSessionModel)->row() != lastSessionRowChecked)
-    {
-      // Cursor moved to a different row. Only build tooltips when moving
-      // cursor to a new row to avoid excessive DBus calls.
-
-      QString selSession = ui.tblSessions->model()->index(ui.tblSessions->indexAt(me->pos()).row(),0).data().toString();
-      QDBusObjectPath spath = QDBusObjectPath(ui.tblSessions->model()->index(ui.tblSessions->indexAt(me->pos()).row(),1).data().toString());
-
-      QString toolTipText;
-      toolTipText.append("<FONT COLOR=white>");
-      toolTipText.append("<b>" + selSession + "</b><hr>");
-
-      // Use the DBus interface to get session properties
-      if (getDbusProperty("test", logdSession, spath) != "invalidIface")
-      {
-        // Session has a valid session DBus object
-        toolTipText.append(i18n("<b>VT:</b> %1", getDbusProperty("VTNr", logdSession, spath).toString()));
-
-        QString remoteHost = getDbusProperty("RemoteHost", logdSession, spath).toString();
-        if (getDbusProperty("Remote", logdSession, spath).toBool())
-        {
-          toolTipText.append(i18n("<br><b>Remote host:</b> %1", remoteHost));
-          toolTipText.append(i18n("<br><b>Remote user:</b> %1", getDbusProperty("RemoteUser", logdSession, spath).toString()));
-        }
-        toolTipText.append(i18n("<br><b>Service:</b> %1", getDbusProperty("Service", logdSession, spath).toString()));
-
-        QString type = getDbusProperty("Type", logdSession, spath).toString();
-        toolTipText.append(i18n("<br><b>Type:</b> %1", type));
-        if (type == "x11")
-          toolTipText.append(i18n(" (display %1)", getDbusProperty("Display", logdSession, spath).toString()));
-        else if (type == "tty")
-        {
-          QString path, tty = getDbusProperty("TTY", logdSession, spath).toString();
-          if (!tty.isEmpty())
-            path = tty;
-          else if (!remoteHost.isEmpty())
-            path = getDbusProperty("Name", logdSession, spath).toString() + "@" + remoteHost;
-          toolTipText.append(" (" + path + ")");
-        }
-        toolTipText.append(i18n("<br><b>Class:</b> %1", getDbusProperty("Class", logdSession, spath).toString()));
-        toolTipText.append(i18n("<br><b>State:</b> %1", getDbusProperty("State", logdSession, spath).toString()));
-        toolTipText.append(i18n("<br><b>Scope:</b> %1", getDbusProperty("Scope", logdSession, spath).toString()));
-
-
-        toolTipText.append(i18n("<br><b>Created: </b>"));
-        if (getDbusProperty("Timestamp", logdSession, spath).toULongLong() == 0)
-          toolTipText.append("n/a");
-        else
-        {
-          QDateTime time;
-          time.setMSecsSinceEpoch(getDbusProperty("Timestamp", logdSession, spath).toULongLong()/1000);
-          toolTipText.append(time.toString());
-        }
-      }
-
-      toolTipText.append("</FONT");
-      sessionModel->itemFromIndex(inSessionModel)->setToolTip(toolTipText);
-
-      lastSessionRowChecked = sessionModel->itemFromIndex(inSessionModel)->row();
-      return true;
-
-    } // Row was different
-  }
-  return false;
-  // return true;
-}
-
 void kcmsystemd::slotSystemSystemdReloading(bool status)
 {
   if (status)
     qDebug() << "System systemd reloading...";
   else
-    slotRefreshUnitsList(false, sys);
+  {
+    graphsStale.insert(sys);
+    slotRefreshUnitsList(sys);
+  }
 }
 
 void kcmsystemd::slotUserSystemdReloading(bool status)
@@ -1928,7 +2583,53 @@ void kcmsystemd::slotUserSystemdReloading(bool status)
   if (status)
     qDebug() << "User systemd reloading...";
   else
-    slotRefreshUnitsList(false, user);
+  {
+    graphsStale.insert(user);
+    slotRefreshUnitsList(user);
+  }
+}
+
+void kcmsystemd::slotSystemUnitPropertiesChanged(QString iface_name, QVariantMap changed, QStringList invalidated, const QDBusMessage &msg)
+{
+  if (systemGraph && iface_name == ifaceUnit)
+    systemGraph->updateUnit(msg.path(), changed, invalidated);
+  if (iface_name == ifaceUnit)
+    applyUnitChanges(msg.path(), changed, sys);
+  else if (iface_name == "org.freedesktop.systemd1.Timer" && initializedTabs.contains(ui.tabTimers))
+    slotRefreshTimerList();
+  systemPropertyModel->updateProperties(msg.path(), iface_name, changed, invalidated);
+}
+
+void kcmsystemd::slotUserUnitPropertiesChanged(QString iface_name, QVariantMap changed, QStringList invalidated, const QDBusMessage &msg)
+{
+  if (userGraph && iface_name == ifaceUnit)
+    userGraph->updateUnit(msg.path(), changed, invalidated);
+  if (iface_name == ifaceUnit)
+    applyUnitChanges(msg.path(), changed, user);
+  else if (iface_name == "org.freedesktop.systemd1.Timer" && initializedTabs.contains(ui.tabTimers))
+    slotRefreshTimerList();
+  userPropertyModel->updateProperties(msg.path(), iface_name, changed, invalidated);
+}
+
+DependencyGraph *kcmsystemd::dependencyGraph(dbusBus bus)
+{
+  // The graphs are only built when first needed. A graph built while its
+  // unit list is still being fetched, or from a filtered list, is built
+  // again once the complete list arrives.
+
+  DependencyGraph *&graph = (bus == user) ? userGraph : systemGraph;
+  if (!graph)
+  {
+    if (bus == user)
+      graph = new DependencyGraph(QDBusConnection::connectToBus(userBusPath, connSystemd), this);
+    else
+      graph = new DependencyGraph(systembus, this);
+    graph->build(bus == user ? userUnitslist : unitslist);
+    updateServerFilter(bus);
+    if (fetchesRunning.contains(bus))
+      graphsStale.insert(bus);
+  }
+  return graph;
 }
 
 /*
@@ -1946,37 +2647,209 @@ void kcmsystemd::slotUnitUnloaded(QString id, QDBusObjectPath path)
 void kcmsystemd::slotSystemUnitsChanged()
 {
   // qDebug() << "System units changed";
-  slotRefreshUnitsList(false, sys);
+  slotRefreshUnitsList(sys);
 }
 
 void kcmsystemd::slotUserUnitsChanged()
 {
   // qDebug() << "User units changed";
-  slotRefreshUnitsList(false, user);
+  slotRefreshUnitsList(user);
+}
+
+void kcmsystemd::slotSystemJobNew(uint id, QDBusObjectPath job, QString unit)
+{
+  jobModel->jobNew(id, unit, QString(), sys);
+  fetchJobType(id, job, sys);
+}
+
+void kcmsystemd::slotUserJobNew(uint id, QDBusObjectPath job, QString unit)
+{
+  jobModel->jobNew(id, unit, QString(), user);
+  fetchJobType(id, job, user);
+}
+
+void kcmsystemd::slotSystemJobRemoved(uint id, QDBusObjectPath, QString unit, QString result)
+{
+  jobModel->jobRemoved(id, unit, result, sys);
+  updateUnit(unit, result, sys);
+}
+
+void kcmsystemd::slotUserJobRemoved(uint id, QDBusObjectPath, QString unit, QString result)
+{
+  jobModel->jobRemoved(id, unit, result, user);
+  updateUnit(unit, result, user);
+}
+
+void kcmsystemd::fetchJobType(uint id, const QDBusObjectPath &job, dbusBus bus)
+{
+  // JobNew does not carry the job type, get it from the job object
+
+  QDBusConnection abus("");
+  if (bus == user)
+    abus = QDBusConnection::connectToBus(userBusPath, connSystemd);
+  else
+    abus = systembus;
+
+  QDBusMessage msg = QDBusMessage::createMethodCall(connSystemd, job.path(), ifaceDbusProp, "Get");
+  msg << "org.freedesktop.systemd1.Job" << "JobType";
+  QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(abus.asyncCall(msg), this);
+  watcher->setProperty("id", id);
+  watcher->setProperty("bus", bus);
+  connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(slotJobTypeFetched(QDBusPendingCallWatcher*)));
+}
+
+void kcmsystemd::slotJobTypeFetched(QDBusPendingCallWatcher *watcher)
+{
+  QDBusPendingReply<QDBusVariant> reply = *watcher;
+  uint id = watcher->property("id").toUInt();
+  dbusBus bus = static_cast<dbusBus>(watcher->property("bus").toInt());
+  watcher->deleteLater();
+
+  // Short jobs may be gone before the reply
+  if (!reply.isError())
+    jobModel->setJobType(id, reply.value().variant().toString(), bus);
+}
+
+void kcmsystemd::updateUnit(const QString &unit, const QString &result, dbusBus bus)
+{
+  // Updates the row of one unit after a job finished, instead of listing
+  // all units again
+
+  const QList<SystemdUnit> *list = (bus == user) ? &userUnitslist : &unitslist;
+  int index = list->indexOf(SystemdUnit(unit));
+  if (index == -1 || list->at(index).unit_path.path().isEmpty())
+  {
+    // A unit we do not know yet, unless the manager left it out
+    if (!serverFilterExcludes(unit, result, bus))
+      slotRefreshUnitsList(bus);
+    return;
+  }
+
+  QDBusConnection abus("");
+  if (bus == user)
+    abus = QDBusConnection::connectToBus(userBusPath, connSystemd);
+  else
+    abus = systembus;
+
+  QDBusMessage msg = QDBusMessage::createMethodCall(connSystemd, list->at(index).unit_path.path(), ifaceDbusProp, "GetAll");
+  msg << ifaceUnit;
+  QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(abus.asyncCall(msg), this);
+  watcher->setProperty("unit", unit);
+  watcher->setProperty("bus", bus);
+  connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(slotUnitPropertiesFetched(QDBusPendingCallWatcher*)));
+}
+
+void kcmsystemd::slotUnitPropertiesFetched(QDBusPendingCallWatcher *watcher)
+{
+  QDBusPendingReply<QVariantMap> reply = *watcher;
+  QString unit = watcher->property("unit").toString();
+  dbusBus bus = static_cast<dbusBus>(watcher->property("bus").toInt());
+  watcher->deleteLater();
+
+  // The unit object is gone once an inactive unit has been unloaded
+  if (reply.isError())
+  {
+    slotRefreshUnitsList(bus);
+    return;
+  }
+
+  const QList<SystemdUnit> &list = (bus == user) ? userUnitslist : unitslist;
+  int index = list.indexOf(SystemdUnit(unit));
+  if (index != -1)
+    applyUnitProperties(index, reply.value(), bus);
+}
+
+void kcmsystemd::applyUnitChanges(const QString &path, const QVariantMap &changed, dbusBus bus)
+{
+  // Updates the row of a unit from its PropertiesChanged signal
+
+  const QList<SystemdUnit> &list = (bus == user) ? userUnitslist : unitslist;
+  for (int index = 0; index < list.size(); ++index)
+  {
+    if (list.at(index).unit_path.path() == path)
+    {
+      applyUnitProperties(index, changed, bus);
+      return;
+    }
+  }
+}
+
+void kcmsystemd::applyUnitProperties(int index, const QVariantMap &props, dbusBus bus)
+{
+  // Applies all properties of a unit, or the ones that changed, to its row
+
+  const QList<SystemdUnit> &list = (bus == user) ? userUnitslist : unitslist;
+  UnitModel *model = (bus == user) ? userUnitModel : systemUnitModel;
+  SystemdUnit u = list.at(index);
+  QString oldActiveState = u.active_state;
+  bool changed = false;
+
+  const char *fields[] = { "LoadState", "ActiveState", "SubState", "Description" };
+  QString *values[] = { &u.load_state, &u.active_state, &u.sub_state, &u.description };
+  for (int i = 0; i < 4; ++i)
+  {
+    if (props.contains(fields[i]) && props.value(fields[i]).toString() != *values[i])
+    {
+      *values[i] = props.value(fields[i]).toString();
+      changed = true;
+    }
+  }
+
+  // A following job may already be queued
+  if (props.contains("Job"))
+  {
+    uint oldJobId = u.job_id;
+    u.job_id = 0;
+    u.job_type.clear();
+    u.job_path = QDBusObjectPath();
+    if (props.value("Job").canConvert<QDBusArgument>())
+    {
+      const QDBusArgument argJob = props.value("Job").value<QDBusArgument>();
+      argJob.beginStructure();
+      argJob >> u.job_id >> u.job_path;
+      argJob.endStructure();
+    }
+    changed |= (u.job_id != oldJobId);
+  }
+
+  if (!changed)
+    return;
+
+  // The proxy filters the changed row again by itself
+  model->setUnit(index, u);
+  if (u.active_state != oldActiveState)
+  {
+    if (u.id == (bus == user ? selectedUserUnit : selectedSystemUnit))
+      showProcesses(bus);
+  }
+}
+
+void kcmsystemd::slotJobStatsChanged()
+{
+  QStringList slowest = jobModel->slowestJobs(3);
+  QString stats = i18n("Running jobs: %1   Finished jobs per second: %2",
+                       jobModel->runningJobs(),
+                       QString::number(jobModel->jobsPerSecond(), 'f', 1));
+  if (!slowest.isEmpty())
+    stats += "\n" + i18n("Slowest: %1", slowest.join(", "));
+  ui.lblJobStats->setText(stats);
 }
 
-void kcmsystemd::slotLogindPropertiesChanged(QString, QVariantMap, QStringList)
+void kcmsystemd::slotLogindPropertiesChanged(QString iface_name, QVariantMap changed, QStringList invalidated, const QDBusMessage &msg)
 {
   // qDebug() << "Logind properties changed on iface " << iface_name;
-  slotRefreshSessionList();
+
+  // Only the object named in the signal needs updating
+  if (iface_name == ifaceSession || iface_name == ifaceLogdUser || iface_name == ifaceSeat)
+    logindSnapshot->updateObject(msg.path(), changed, invalidated);
 }
 
 void kcmsystemd::slotLeSearchUnitChanged(QString term)
 {
   if (QObject::sender()->objectName() == "leSearchUnit")
-  {
     systemUnitFilterModel->addFilterRegExp(unitName, term);
-    systemUnitFilterModel->invalidate();
-    ui.tblUnits->sortByColumn(ui.tblUnits->horizontalHeader()->sortIndicatorSection(),
-                              ui.tblUnits->horizontalHeader()->sortIndicatorOrder());
-  }
   else if (QObject::sender()->objectName() == "leSearchUserUnit")
-  {
     userUnitFilterModel->addFilterRegExp(unitName, term);
-    userUnitFilterModel->invalidate();
-    ui.tblUserUnits->sortByColumn(ui.tblUserUnits->horizontalHeader()->sortIndicatorSection(),
-                                  ui.tblUserUnits->horizontalHeader()->sortIndicatorOrder());
-  }
   updateUnitCount();
 }
 
@@ -2037,82 +2910,339 @@ void kcmsystemd::slotUpdateTimers()
   }
 }
 
-QList<SystemdUnit> kcmsystemd::getUnitsFromDbus(dbusBus bus)
+void kcmsystemd::slotUpdateMonitoredUnits()
 {
-  // get an updated list of units via dbus
+  QMetaObject::invokeMethod(systemSampler, "setUnits", Qt::QueuedConnection, Q_ARG(CgroupPathMap, monitoredUnits(sys)));
+  if (enableUserUnits)
+    QMetaObject::invokeMethod(userSampler, "setUnits", Qt::QueuedConnection, Q_ARG(CgroupPathMap, monitoredUnits(user)));
+}
 
-  QList<SystemdUnit> list;
-  QList<unitfile> unitfileslist;
-  QDBusMessage dbusreply;
+CgroupPathMap kcmsystemd::monitoredUnits(dbusBus bus)
+{
+  // Returns the control groups of the units that should be sampled
 
-  dbusreply = callDbusMethod("ListUnits", sysdMgr, bus);
+  QTableView *tblView = ui.tblUnits;
+  SortFilterUnitModel *filterModel = systemUnitFilterModel;
+  const QList<SystemdUnit> *list = &unitslist;
+  const QHash<QString, QString> *cgroups = &systemCgroups;
+  bool treeMode = ui.chkSliceTree->isChecked();
+  if (bus == user)
+  {
+    tblView = ui.tblUserUnits;
+    filterModel = userUnitFilterModel;
+    list = &userUnitslist;
+    cgroups = &userCgroups;
+    treeMode = ui.chkUserSliceTree->isChecked();
+  }
 
-  const QDBusArgument argUnits = dbusreply.arguments().at(0).value<QDBusArgument>();
-  int tal = 0;
-  if (argUnits.currentType() == QDBusArgument::ArrayType)
+  // The slice tree needs every running unit to sum up the slices. Otherwise
+  // sample all displayed rows when sorting on a resource column, or only
+  // those in the viewport.
+  int first = 0, last = treeMode ? list->size() - 1 : filterModel->rowCount() - 1;
+  if (!treeMode && tblView->horizontalHeader()->sortIndicatorSection() < 4)
   {
-    argUnits.beginArray();
-    while (!argUnits.atEnd())
-    {
-      SystemdUnit unit;
-      argUnits >> unit;
-      list.append(unit);
+    first = qMax(0, tblView->rowAt(0));
+    int bottom = tblView->rowAt(tblView->viewport()->height() - 1);
+    if (bottom != -1)
+      last = bottom;
+  }
 
-      // qDebug() << "Added unit " << unit.id;
-      tal++;
-    }
-    argUnits.endArray();
+  CgroupPathMap map;
+  for (int row = first; row <= last; ++row)
+  {
+    int sourceRow = treeMode ? row : filterModel->mapToSource(filterModel->index(row, 0)).row();
+    if (sourceRow < 0 || sourceRow >= list->size())
+      continue;
+
+    const SystemdUnit &unit = list->at(sourceRow);
+    if (!unit.id.endsWith(".service") && !unit.id.endsWith(".scope") && !unit.id.endsWith(".slice"))
+      continue;
+
+    // Units that are not running have no control group
+    if (unit.unit_path.path().isEmpty() ||
+        unit.active_state == "inactive" ||
+        unit.active_state == "failed" ||
+        unit.active_state == "-")
+      continue;
+
+    QHash<QString, QString>::const_iterator it = cgroups->constFind(unit.id);
+    if (it != cgroups->constEnd())
+      map.insert(unit.id, it.value());
+    else
+      fetchControlGroup(unit, bus);
   }
-  // qDebug() << "Added " << tal << " units on bus " << bus;
-  tal = 0;
+  return map;
+}
+
+void kcmsystemd::fetchControlGroup(const SystemdUnit &unit, dbusBus bus)
+{
+  // Get the ControlGroup property asynchronously. It lives on the
+  // type-specific interface of the unit.
+
+  QString key = QString::number(bus) + unit.id;
+  if (pendingCgroups.contains(key))
+    return;
+
+  QString ifc;
+  if (unit.id.endsWith(".service"))
+    ifc = "org.freedesktop.systemd1.Service";
+  else if (unit.id.endsWith(".scope"))
+    ifc = "org.freedesktop.systemd1.Scope";
+  else
+    ifc = "org.freedesktop.systemd1.Slice";
 
-  // Get a list of unit files
-  dbusreply = callDbusMethod("ListUnitFiles", sysdMgr, bus);
-  const QDBusArgument argUnitFiles = dbusreply.arguments().at(0).value<QDBusArgument>();
-  argUnitFiles.beginArray();
-  while (!argUnitFiles.atEnd())
+  QDBusConnection abus("");
+  if (bus == user)
+    abus = QDBusConnection::connectToBus(userBusPath, connSystemd);
+  else
+    abus = systembus;
+
+  QDBusMessage msg = QDBusMessage::createMethodCall(connSystemd, unit.unit_path.path(), ifaceDbusProp, "Get");
+  msg << ifc << "ControlGroup";
+  QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(abus.asyncCall(msg), this);
+  watcher->setProperty("unit", unit.id);
+  watcher->setProperty("bus", bus);
+  connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(slotControlGroupFetched(QDBusPendingCallWatcher*)));
+  pendingCgroups.insert(key);
+}
+
+void kcmsystemd::slotControlGroupFetched(QDBusPendingCallWatcher *watcher)
+{
+  QDBusPendingReply<QDBusVariant> reply = *watcher;
+  QString unit = watcher->property("unit").toString();
+  dbusBus bus = static_cast<dbusBus>(watcher->property("bus").toInt());
+  watcher->deleteLater();
+  pendingCgroups.remove(QString::number(bus) + unit);
+
+  if (reply.isError())
+    return;
+
+  QString cgroup = reply.value().variant().toString();
+  if (cgroup.isEmpty())
+    return;
+
+  if (bus == user)
+    userCgroups.insert(unit, cgroup);
+  else
+    systemCgroups.insert(unit, cgroup);
+  monitorTimer->start();
+
+  if (unit == (bus == user ? selectedUserUnit : selectedSystemUnit))
+    showProcesses(bus);
+}
+
+void kcmsystemd::slotUnitSelected(const QModelIndex &current)
+{
+  dbusBus bus = sys;
+  if (QObject::sender() == ui.tblUserUnits->selectionModel())
+    bus = user;
+
+  QString unit;
+  if (current.isValid())
+    unit = current.sibling(current.row(), 3).data().toString();
+
+  QString &selected = (bus == user) ? selectedUserUnit : selectedSystemUnit;
+  if (unit == selected)
+    return;
+  selected = unit;
+  showProcesses(bus);
+  showProperties(bus);
+}
+
+void kcmsystemd::showProperties(dbusBus bus)
+{
+  // Loads the property table of the selected unit. Units that are not
+  // loaded have no object to ask.
+
+  const QList<SystemdUnit> &list = (bus == user) ? userUnitslist : unitslist;
+  const QString &unitId = (bus == user) ? selectedUserUnit : selectedSystemUnit;
+  QTableView *tblView = (bus == user) ? ui.tblUserUnitProperties : ui.tblUnitProperties;
+
+  QString path;
+  int index = list.indexOf(SystemdUnit(unitId));
+  if (index != -1)
+    path = list.at(index).unit_path.path();
+
+  ((bus == user) ? userPropertyModel : systemPropertyModel)->setUnit(unitId, path);
+  tblView->setVisible(!path.isEmpty());
+}
+
+void kcmsystemd::showProcesses(dbusBus bus)
+{
+  // Points the process sampler at the control group of the selected unit,
+  // or hides the process list if the unit has no control group
+
+  ProcessSampler *sampler = systemProcSampler;
+  QTableView *tblView = ui.tblProcesses;
+  const QList<SystemdUnit> *list = &unitslist;
+  const QHash<QString, QString> *cgroups = &systemCgroups;
+  QString unitId = selectedSystemUnit;
+  if (bus == user)
   {
-    unitfile u;
-    argUnitFiles.beginStructure();
-    argUnitFiles >> u.name >> u.status;
-    argUnitFiles.endStructure();
-    unitfileslist.append(u);
+    sampler = userProcSampler;
+    tblView = ui.tblUserProcesses;
+    list = &userUnitslist;
+    cgroups = &userCgroups;
+    unitId = selectedUserUnit;
   }
-  argUnitFiles.endArray();
 
-  // Add unloaded units to the list
-  for (int i = 0;  i < unitfileslist.size(); ++i)
+  QString cgroup;
+  int index = list->indexOf(SystemdUnit(unitId));
+  if (index != -1)
   {
-    int index = list.indexOf(SystemdUnit(unitfileslist.at(i).name.section('/',-1)));
-    if (index > -1)
+    const SystemdUnit &unit = list->at(index);
+    bool running = !unit.unit_path.path().isEmpty() &&
+                   unit.active_state != "inactive" &&
+                   unit.active_state != "failed" &&
+                   unit.active_state != "-";
+    if (running && (unit.id.endsWith(".service") || unit.id.endsWith(".scope") || unit.id.endsWith(".slice")))
     {
-      // The unit was already in the list, add unit file and its status
-      list[index].unit_file = unitfileslist.at(i).name;
-      list[index].unit_file_status = unitfileslist.at(i).status;
+      cgroup = cgroups->value(unit.id);
+      // Shown once the control group has been fetched
+      if (cgroup.isEmpty())
+        fetchControlGroup(unit, bus);
     }
-    else
+  }
+
+  QMetaObject::invokeMethod(sampler, "setCgroup", Qt::QueuedConnection, Q_ARG(QString, cgroup));
+  tblView->setVisible(!cgroup.isEmpty());
+}
+
+void kcmsystemd::slotChkSliceTree(int state)
+{
+  // Switch between the flat unit list and the slice tree
+
+  dbusBus bus = sys;
+  QTableView *tblView = ui.tblUnits;
+  QTreeView *treeView = ui.treeUnits;
+  if (QObject::sender()->objectName() == "chkUserSliceTree")
+  {
+    bus = user;
+    tblView = ui.tblUserUnits;
+    treeView = ui.treeUserUnits;
+  }
+
+  tblView->setVisible(state != Qt::Checked);
+  treeView->setVisible(state == Qt::Checked);
+  if (state == Qt::Checked)
+    updateSliceTree(bus);
+  monitorTimer->start();
+}
+
+void kcmsystemd::updateSliceTree(dbusBus bus)
+{
+  // Brings the slice tree in line with the unit list. Slices of new units
+  // are fetched asynchronously, a bounded number at a time, and the units
+  // are placed when they arrive.
+
+  const QList<SystemdUnit> *list = &unitslist;
+  QHash<QString, QString> *slices = &systemSlices;
+  SliceTreeModel *model = systemSliceModel;
+  if (bus == user)
+  {
+    list = &userUnitslist;
+    slices = &userSlices;
+    model = userSliceModel;
+  }
+
+  QSet<QString> loaded;
+  foreach (const SystemdUnit &unit, *list)
+  {
+    if ((!unit.id.endsWith(".service") && !unit.id.endsWith(".scope")) ||
+        unit.unit_path.path().isEmpty() ||
+        unit.active_state == "inactive" ||
+        unit.active_state == "failed" ||
+        unit.active_state == "-")
+      continue;
+    loaded.insert(unit.id);
+
+    QHash<QString, QString>::const_iterator it = slices->constFind(unit.id);
+    if (it != slices->constEnd())
     {
-      // Unit not in the list, add it
-      QFile unitfile(unitfileslist.at(i).name);
-      if (unitfile.symLinkTarget().isEmpty())
-      {
-        SystemdUnit unit;
-        unit.id = unitfileslist.at(i).name.section('/',-1);
-        unit.load_state = "unloaded";
-        unit.active_state = "-";
-        unit.sub_state = "-";
-        unit.unit_file = unitfileslist.at(i).name;
-        unit.unit_file_status= unitfileslist.at(i).status;
-        list.append(unit);
-
-        // qDebug() << "Added unit " << unit.id;
-        tal++;
-      }
+      model->setUnitSlice(unit.id, it.value());
+      continue;
     }
+
+    QString key = QString::number(bus) + unit.id;
+    if (pendingSlices.contains(key))
+      continue;
+
+    sliceQueue[bus] << qMakePair(unit.id, unit.unit_path.path());
+    pendingSlices.insert(key);
+  }
+  fetchSlices(bus);
+
+  // Remove units that stopped or disappeared
+  foreach (const QString &id, model->unitIds())
+  {
+    if (!loaded.contains(id))
+      model->removeUnit(id);
   }
-  // qDebug() << "Added " << tal << " units from files on bus " << bus;
+}
+
+void kcmsystemd::fetchSlices(dbusBus bus)
+{
+  // Sends queued slice requests while there is room. The bus only allows a
+  // limited number of pending replies per connection.
+
+  QList<QPair<QString, QString> > &queue = sliceQueue[bus];
+  if (queue.isEmpty() || sliceFetches.value(bus) >= maxSliceFetches)
+    return;
+
+  QDBusConnection abus("");
+  if (bus == user)
+    abus = QDBusConnection::connectToBus(userBusPath, connSystemd);
+  else
+    abus = systembus;
 
-  return list;
+  while (sliceFetches.value(bus) < maxSliceFetches && !queue.isEmpty())
+  {
+    QPair<QString, QString> unit = queue.takeFirst();
+    QDBusMessage msg = QDBusMessage::createMethodCall(connSystemd, unit.second, ifaceDbusProp, "Get");
+    msg << ifaceUnit << "Slice";
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(abus.asyncCall(msg), this);
+    watcher->setProperty("unit", unit.first);
+    watcher->setProperty("path", unit.second);
+    watcher->setProperty("bus", bus);
+    connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(slotSliceFetched(QDBusPendingCallWatcher*)));
+    ++sliceFetches[bus];
+  }
+}
+
+void kcmsystemd::slotSliceFetched(QDBusPendingCallWatcher *watcher)
+{
+  QDBusPendingReply<QDBusVariant> reply = *watcher;
+  QString unit = watcher->property("unit").toString();
+  dbusBus bus = static_cast<dbusBus>(watcher->property("bus").toInt());
+  watcher->deleteLater();
+  --sliceFetches[bus];
+
+  // Asked again once other calls have finished
+  if (reply.isError() && reply.error().name() == "org.freedesktop.DBus.Error.LimitsExceeded")
+  {
+    sliceQueue[bus] << qMakePair(unit, watcher->property("path").toString());
+    fetchSlices(bus);
+    return;
+  }
+
+  pendingSlices.remove(QString::number(bus) + unit);
+  fetchSlices(bus);
+  if (reply.isError())
+    return;
+
+  QString slice = reply.value().variant().toString();
+  if (bus == user)
+  {
+    userSlices.insert(unit, slice);
+    if (ui.chkUserSliceTree->isChecked())
+      userSliceModel->setUnitSlice(unit, slice);
+  }
+  else
+  {
+    systemSlices.insert(unit, slice);
+    if (ui.chkSliceTree->isChecked())
+      systemSliceModel->setUnitSlice(unit, slice);
+  }
 }
 
 QVariant kcmsystemd::getDbusProperty(QString prop, dbusIface ifaceName, QDBusObjectPath path, dbusBus bus)
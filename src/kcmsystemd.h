@@ -29,23 +29,31 @@
 #include "ui_kcmsystemd.h"
 #include "systemdunit.h"
 #include "unitmodel.h"
+#include "unitlistfetcher.h"
+#include "snapshotcache.h"
 #include "sortfilterunitmodel.h"
+#include "unitprefetcher.h"
+#include "unitmetadatacache.h"
+#include "unitpropertymodel.h"
+#include "unitbatch.h"
+#include "slicetreemodel.h"
+#include "processmodel.h"
+#include "jobmodel.h"
+#include "restartorchestrator.h"
+#include "dependencygraph.h"
+#include "dependencydialog.h"
+#include "bootchart.h"
+#include "boothistorymodel.h"
+#include "latencytrenddelegate.h"
+#include "logindsnapshot.h"
+#include "sessionmodel.h"
+#include "logindusermodel.h"
+#include "seatmodel.h"
 #include "confoption.h"
 #include "confmodel.h"
 #include "confdelegate.h"
-
-struct unitfile
-{
-  QString name, status;
-  
-  bool operator==(const unitfile& right) const
-  {
-    if (name.section('/',-1) == right.name)
-      return true;
-    else
-      return false;
-  }
-};
+#include "sparklinedelegate.h"
+#include "unitfilechanges.h"
 
 enum dbusConn
 {
@@ -70,40 +78,95 @@ class kcmsystemd : public KCModule
     static ConfModel *confModel;
     static QList<confOption> confOptList;
 
+  protected:
+    void showEvent(QShowEvent *event);
+
   private:
     Ui::kcmsystemd ui;
     void setupSignalSlots();
     void setupUnitslist();
+    void setupUnitFetchers();
+    void restoreSnapshot();
+    void updateServerFilter(dbusBus bus);
+    void saveSnapshot();
+    void setupMonitor();
     void setupConf();
-    void setupSessionlist();
+    void setupLogindLists();
     void setupTimerlist();
+    void setupJobList();
+    void setupBootAnalysis();
+    void loadJobList();
+    void loadBootAnalysis();
+    void initTab(QWidget *tab);
+    void logStartupPhase(const char *phase, QElapsedTimer &phaseClock);
     void readConfFile(int);
     void authServiceAction(QString, QString, QString, QString, QList<QVariant>);
-    bool eventFilter(QObject *, QEvent*);
+    void batchUnitAction(const QString &method, const QStringList &units, dbusBus bus);
+    void restartInParallel(const QStringList &units, dbusBus bus);
+    DependencyGraph *dependencyGraph(dbusBus bus);
     void updateUnitCount();
     void setupConfigParms();
-    QList<SystemdUnit> getUnitsFromDbus(dbusBus bus);
     QVariant getDbusProperty(QString prop, dbusIface ifaceName, QDBusObjectPath path = QDBusObjectPath("/org/freedesktop/systemd1"), dbusBus bus = sys);
     QDBusMessage callDbusMethod(QString method, dbusIface ifaceName, dbusBus bus = sys, const QList<QVariant> &args = QList<QVariant> ());
+    CgroupPathMap monitoredUnits(dbusBus bus);
+    void fetchControlGroup(const SystemdUnit &unit, dbusBus bus);
+    void updateSliceTree(dbusBus bus);
+    void fetchSlices(dbusBus bus);
+    void showProcesses(dbusBus bus);
+    void showProperties(dbusBus bus);
+    void fetchJobType(uint id, const QDBusObjectPath &job, dbusBus bus);
+    void updateUnit(const QString &unit, const QString &result, dbusBus bus);
+    bool isServerFiltered(dbusBus bus) const;
+    bool serverFilterExcludes(const QString &unit, const QString &result, dbusBus bus) const;
+    void applyUnitChanges(const QString &path, const QVariantMap &changed, dbusBus bus);
+    void applyUnitProperties(int index, const QVariantMap &props, dbusBus bus);
     QList<QStandardItem *> buildTimerListRow(const SystemdUnit &unit, const QList<SystemdUnit> &list, dbusBus bus);
     QProcess *kdeConfig;
     QSortFilterProxyModel *proxyModelConf;
     SortFilterUnitModel *systemUnitFilterModel, *userUnitFilterModel;
-    QStandardItemModel *sessionModel, *timerModel;
+    QStandardItemModel *timerModel;
+    JobModel *jobModel;
+    DependencyGraph *systemGraph = NULL, *userGraph = NULL;
+    QStandardItemModel *blameModel;
+    BootChart *bootChart;
+    BootHistory *bootHistory;
+    QVariantMap bootTimestamps;
+    LogindSnapshot *logindSnapshot;
+    SessionModel *sessionModel;
+    LogindUserModel *logindUserModel;
+    SeatModel *seatModel;
     UnitModel *systemUnitModel, *userUnitModel;
+    UnitMetadataCache *metadataCache;
+    UnitPropertyModel *systemPropertyModel, *userPropertyModel;
     QList<SystemdUnit> unitslist, userUnitslist;
-    QList<SystemdSession> sessionlist;
-    QStringList listConfFiles;
+    QStringList listConfFiles, unitTypeNames;
     QString kdePrefix, etcDir, userBusPath;
     QMenu *contextMenuUnits;
     QAction *actEnableUnit, *actDisableUnit;
-    int systemdVersion, timesLoad = 0, lastUnitRowChecked = -1, lastSessionRowChecked = -1, noActSystemUnits, noActUserUnits;
+    int systemdVersion, timesLoad = 0, lastUnitRowChecked = -1;
     qulonglong partPersSizeMB, partVolaSizeMB;
     bool enableUserUnits = true;
-    QTimer *timer;
-    const QStringList unitTypeSufx = QStringList() << "" << ".target" << ".service" << ".device" << ".mount"
-                                                   << ".automount" << ".swap" << ".socket" << ".path"
-                                                   << ".timer" << ".snapshot" << ".slice" << ".scope";
+    QTimer *timer, *monitorTimer;
+    QThread *monitorThread = NULL, *systemFetchThread = NULL, *userFetchThread = NULL;
+    UnitListFetcher *systemFetcher = NULL, *userFetcher = NULL;
+    ModuleSnapshot snapshot;
+    QSet<int> fetchesRunning, fetchesQueued, graphsStale;
+    QHash<int, QStringList> serverStates, serverPatterns;
+    CgroupSampler *systemSampler, *userSampler;
+    QHash<QString, QString> systemCgroups, userCgroups, systemSlices, userSlices;
+    QSet<QString> pendingCgroups, pendingSlices;
+    QHash<int, QList<QPair<QString, QString> > > sliceQueue;
+    QHash<int, int> sliceFetches;
+    static const int maxSliceFetches = 32;
+    SliceTreeModel *systemSliceModel, *userSliceModel;
+    ProcessSampler *systemProcSampler, *userProcSampler;
+    ProcessModel *systemProcessModel, *userProcessModel;
+    QString selectedSystemUnit, selectedUserUnit;
+    QElapsedTimer startupClock;
+    bool startupShown = false, setupDone = false;
+    QSet<QWidget *> initializedTabs;
+    QList<QWidget *> prefetchTabs;
+    const QStringList unitTypeSufx = UnitModel::typeSuffixes();
     const QString connSystemd = "org.freedesktop.systemd1";
     const QString connLogind = "org.freedesktop.login1";
     const QString pathSysdMgr = "/org/freedesktop/systemd1";
@@ -113,17 +176,21 @@ class kcmsystemd : public KCModule
     const QString ifaceUnit = "org.freedesktop.systemd1.Unit";
     const QString ifaceTimer = "org.freedesktop.systemd1.Timer";
     const QString ifaceSession = "org.freedesktop.login1.Session";
+    const QString ifaceLogdUser = "org.freedesktop.login1.User";
+    const QString ifaceSeat = "org.freedesktop.login1.Seat";
     const QString ifaceDbusProp = "org.freedesktop.DBus.Properties";
     QDBusConnection systembus = QDBusConnection::systemBus();
 
   private slots:
     void slotKdeConfig();
     void slotChkShowUnits(int);
+    void slotUnitFacetsChanged();
     void slotCmbUnitTypes(int);
     void slotUnitContextMenu(const QPoint &);
     void slotSessionContextMenu(const QPoint &);
-    void slotRefreshUnitsList(bool, dbusBus);
-    void slotRefreshSessionList();
+    void slotRefreshUnitsList(dbusBus);
+    void slotUnitsFetched(const QList<SystemdUnit> &, int);
+    void slotUnitsFetchFailed(int);
     void slotRefreshTimerList();
     void slotSystemSystemdReloading(bool);
     void slotUserSystemdReloading(bool);
@@ -131,11 +198,32 @@ class kcmsystemd : public KCModule
     void slotUserUnitsChanged();
     // void slotUnitLoaded(QString, QDBusObjectPath);
     // void slotUnitUnloaded(QString, QDBusObjectPath);
-    void slotLogindPropertiesChanged(QString, QVariantMap, QStringList);
+    void slotLogindPropertiesChanged(QString, QVariantMap, QStringList, const QDBusMessage &);
     void slotLeSearchUnitChanged(QString);
     void slotConfChanged(const QModelIndex &, const QModelIndex &);
     void slotCmbConfFileChanged(int);
     void slotUpdateTimers();
+    void slotUpdateMonitoredUnits();
+    void slotControlGroupFetched(QDBusPendingCallWatcher *);
+    void slotChkSliceTree(int);
+    void slotSliceFetched(QDBusPendingCallWatcher *);
+    void slotUnitSelected(const QModelIndex &);
+    void slotSystemJobNew(uint, QDBusObjectPath, QString);
+    void slotUserJobNew(uint, QDBusObjectPath, QString);
+    void slotSystemJobRemoved(uint, QDBusObjectPath, QString, QString);
+    void slotUserJobRemoved(uint, QDBusObjectPath, QString, QString);
+    void slotJobTypeFetched(QDBusPendingCallWatcher *);
+    void slotUnitPropertiesFetched(QDBusPendingCallWatcher *);
+    void slotJobStatsChanged();
+    void slotRestartsFinished(const QStringList &, int);
+    void slotBatchFinished(const QVariantMap &);
+    void slotSystemUnitPropertiesChanged(QString, QVariantMap, QStringList, const QDBusMessage &);
+    void slotUserUnitPropertiesChanged(QString, QVariantMap, QStringList, const QDBusMessage &);
+    void slotTabChanged(int);
+    void slotStartupPainted();
+    void slotPrefetchNextTab();
+    void slotBootTimestampsFetched(QDBusPendingCallWatcher *);
+    void slotFillBootAnalysis();
 };
 
 #endif // kcmsystemd_H
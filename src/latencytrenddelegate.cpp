@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QPainter>
+
+#include "latencytrenddelegate.h"
+#include "boothistorymodel.h"
+
+LatencyTrendDelegate::LatencyTrendDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+void LatencyTrendDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
+                                 const QModelIndex &index) const
+{
+  // Paints the background as usual and the latency of every boot as a
+  // polyline, oldest boot at the left
+
+  QStyledItemDelegate::paint(painter, option, index);
+
+  QVariantList series = index.data(BootHistoryModel::SeriesRole).toList();
+  if (series.size() < 2)
+    return;
+
+  quint32 max = 1;
+  foreach (const QVariant &value, series)
+    max = qMax(max, value.toUInt());
+
+  QRect rect = option.rect.adjusted(3, 3, -3, -3);
+  QPolygonF points;
+  for (int i = 0; i < series.size(); ++i)
+    points << QPointF(rect.left() + qreal(i) * rect.width() / (series.size() - 1),
+                      rect.bottom() - qreal(series.at(i).toUInt()) * rect.height() / max);
+
+  QColor color = index.data(Qt::ForegroundRole).value<QColor>();
+  if (!color.isValid())
+    color = option.palette.color(QPalette::Highlight);
+  painter->save();
+  painter->setRenderHint(QPainter::Antialiasing, true);
+  painter->setPen(color);
+  painter->drawPolyline(points);
+  painter->restore();
+}
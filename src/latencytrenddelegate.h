@@ -0,0 +1,36 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef LATENCYTRENDDELEGATE_H
+#define LATENCYTRENDDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+// Draws the series of BootHistoryModel::SeriesRole as a line, scaled to
+// its own maximum
+class LatencyTrendDelegate : public QStyledItemDelegate
+{
+  Q_OBJECT
+
+public:
+  LatencyTrendDelegate(QObject *parent = 0);
+
+  void paint(QPainter *painter, const QStyleOptionViewItem &option,
+             const QModelIndex &index) const Q_DECL_OVERRIDE;
+};
+
+#endif // LATENCYTRENDDELEGATE_H
@@ -0,0 +1,105 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include "logindmodel.h"
+
+LogindModel::LogindModel(LogindSnapshot *snapshot, logindObject type, QObject *parent)
+ : QAbstractTableModel(parent)
+{
+  logindSnapshot = snapshot;
+  objectType = type;
+
+  connect(logindSnapshot, SIGNAL(objectAdded(int, const QString &)), this, SLOT(slotObjectAdded(int, const QString &)));
+  connect(logindSnapshot, SIGNAL(objectChanged(int, const QString &)), this, SLOT(slotObjectChanged(int, const QString &)));
+  connect(logindSnapshot, SIGNAL(objectRemoved(int, const QString &)), this, SLOT(slotObjectRemoved(int, const QString &)));
+}
+
+int LogindModel::rowCount(const QModelIndex &) const
+{
+  return pathList.size();
+}
+
+QString LogindModel::pathAt(int row) const
+{
+  if (row < 0 || row >= pathList.size())
+    return QString();
+  return pathList.at(row);
+}
+
+QVariant LogindModel::objectProperty(int row, const QString &prop) const
+{
+  return propertiesAt(row).value(prop);
+}
+
+QVariantMap LogindModel::propertiesAt(int row) const
+{
+  if (row < 0 || row >= pathList.size())
+    return QVariantMap();
+  return logindSnapshot->properties(pathList.at(row));
+}
+
+void LogindModel::objectUpdated(const QString &, bool)
+{
+  // Reimplemented by models that cache values derived from the properties
+}
+
+void LogindModel::slotObjectAdded(int type, const QString &path)
+{
+  if (type != objectType || rowByPath.contains(path))
+    return;
+
+  int row = pathList.size();
+  beginInsertRows(QModelIndex(), row, row);
+  pathList.append(path);
+  rowByPath.insert(path, row);
+  objectUpdated(path, false);
+  endInsertRows();
+}
+
+void LogindModel::slotObjectChanged(int type, const QString &path)
+{
+  if (type != objectType)
+    return;
+
+  QHash<QString, int>::const_iterator it = rowByPath.constFind(path);
+  if (it == rowByPath.constEnd())
+    return;
+
+  objectUpdated(path, false);
+  emit dataChanged(index(it.value(), 0), index(it.value(), columnCount() - 1));
+}
+
+void LogindModel::slotObjectRemoved(int type, const QString &path)
+{
+  if (type != objectType)
+    return;
+
+  QHash<QString, int>::const_iterator it = rowByPath.constFind(path);
+  if (it == rowByPath.constEnd())
+    return;
+
+  int row = it.value();
+  beginRemoveRows(QModelIndex(), row, row);
+  rowByPath.remove(path);
+  pathList.removeAt(row);
+
+  // Rows after the removed one have moved up
+  for (int i = row; i < pathList.size(); ++i)
+    rowByPath[pathList.at(i)] = i;
+  objectUpdated(path, true);
+  endRemoveRows();
+}
@@ -0,0 +1,54 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef LOGINDMODEL_H
+#define LOGINDMODEL_H
+
+#include <QAbstractTableModel>
+
+#include "logindsnapshot.h"
+
+// Base class for the session, user and seat models. Each row is one logind
+// object of the given type in the shared snapshot, and rows are kept in sync
+// with the snapshot signals.
+class LogindModel : public QAbstractTableModel
+{
+  Q_OBJECT
+
+public:
+  LogindModel(LogindSnapshot *snapshot, logindObject type, QObject *parent = 0);
+  int rowCount(const QModelIndex & parent = QModelIndex()) const;
+  QString pathAt(int row) const;
+  QVariant objectProperty(int row, const QString &prop) const;
+
+protected:
+  virtual void objectUpdated(const QString &path, bool removed);
+  QVariantMap propertiesAt(int row) const;
+  LogindSnapshot *logindSnapshot;
+
+private slots:
+  void slotObjectAdded(int type, const QString &path);
+  void slotObjectChanged(int type, const QString &path);
+  void slotObjectRemoved(int type, const QString &path);
+
+private:
+  int objectType;
+  QStringList pathList;
+  QHash<QString, int> rowByPath;
+};
+
+#endif // LOGINDMODEL_H
@@ -0,0 +1,400 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include "logindsnapshot.h"
+
+LogindSnapshot::LogindSnapshot(QObject *parent)
+ : QObject(parent)
+{
+}
+
+void LogindSnapshot::refresh()
+{
+  // Start a complete reload. The three list calls are sent at once, and when
+  // all of them have returned the GetAll calls for every object are sent.
+
+  if (pendingLists > 0 || pendingGetAll > 0)
+    return;
+
+  batchPaths.clear();
+  batchResults.clear();
+  batchFailed.clear();
+  batchRetries.clear();
+  batchStale = objects.keys().toSet();
+  pendingLists = 3;
+  listObjects(logindSession, "ListSessions");
+  listObjects(logindUser, "ListUsers");
+  listObjects(logindSeat, "ListSeats");
+}
+
+bool LogindSnapshot::contains(const QString &path) const
+{
+  return objects.contains(path);
+}
+
+QVariantMap LogindSnapshot::properties(const QString &path) const
+{
+  QHash<QString, LogindEntry>::const_iterator it = objects.constFind(path);
+  if (it == objects.constEnd())
+    return QVariantMap();
+  return it.value().properties;
+}
+
+QStringList LogindSnapshot::paths(logindObject type) const
+{
+  QStringList list;
+  for (QHash<QString, LogindEntry>::const_iterator it = objects.constBegin(); it != objects.constEnd(); ++it)
+  {
+    if (it.value().type == type)
+      list << it.key();
+  }
+  return list;
+}
+
+void LogindSnapshot::updateObject(const QString &path, const QVariantMap &changed, const QStringList &invalidated)
+{
+  // Apply a PropertiesChanged signal to a single object
+
+  QHash<QString, LogindEntry>::iterator it = objects.find(path);
+  if (it == objects.end())
+    return;
+
+  if (!changed.isEmpty())
+  {
+    QVariantMap flat = flattenProperties(changed);
+    for (QVariantMap::const_iterator iter = flat.constBegin(); iter != flat.constEnd(); ++iter)
+      it.value().properties[iter.key()] = iter.value();
+    emit objectChanged(it.value().type, path);
+  }
+
+  // Invalidated properties are not sent along, so the cached copy of
+  // them is stale. Fetch all properties of this object again.
+  if (!invalidated.isEmpty())
+    fetchProperties(static_cast<logindObject>(it.value().type), path, false);
+}
+
+QByteArray LogindSnapshot::saveState() const
+{
+  // Object paths are kept as strings, other D-Bus types are dropped
+
+  QByteArray state;
+  QDataStream stream(&state, QIODevice::WriteOnly);
+  stream << objects.size();
+  for (QHash<QString, LogindEntry>::const_iterator it = objects.constBegin(); it != objects.constEnd(); ++it)
+  {
+    QVariantMap props;
+    for (QVariantMap::const_iterator prop = it.value().properties.constBegin(); prop != it.value().properties.constEnd(); ++prop)
+    {
+      if (prop.value().userType() == qMetaTypeId<QDBusObjectPath>())
+        props.insert(prop.key(), prop.value().value<QDBusObjectPath>().path());
+      else if (prop.value().userType() < QMetaType::User)
+        props.insert(prop.key(), prop.value());
+    }
+    stream << it.key() << it.value().type << props;
+  }
+  return state;
+}
+
+void LogindSnapshot::restoreState(const QByteArray &state)
+{
+  // Fills an empty snapshot from a saved state. A later refresh() replaces
+  // the restored objects that are gone and updates the rest.
+
+  if (!objects.isEmpty() || state.isEmpty())
+    return;
+
+  QDataStream stream(state);
+  int count;
+  stream >> count;
+  for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+  {
+    QString path;
+    LogindEntry entry;
+    stream >> path >> entry.type >> entry.properties;
+    if (stream.status() != QDataStream::Ok)
+      break;
+    objects.insert(path, entry);
+    emit objectAdded(entry.type, path);
+  }
+  emit snapshotLoaded();
+}
+
+void LogindSnapshot::slotSessionNew(QString, QDBusObjectPath path)
+{
+  addObject(logindSession, path.path());
+}
+
+void LogindSnapshot::slotSessionRemoved(QString, QDBusObjectPath path)
+{
+  removeObject(path.path());
+}
+
+void LogindSnapshot::slotUserNew(uint, QDBusObjectPath path)
+{
+  addObject(logindUser, path.path());
+}
+
+void LogindSnapshot::slotUserRemoved(uint, QDBusObjectPath path)
+{
+  removeObject(path.path());
+}
+
+void LogindSnapshot::slotSeatNew(QString, QDBusObjectPath path)
+{
+  addObject(logindSeat, path.path());
+}
+
+void LogindSnapshot::slotSeatRemoved(QString, QDBusObjectPath path)
+{
+  removeObject(path.path());
+}
+
+void LogindSnapshot::listObjects(logindObject type, const QString &method)
+{
+  QDBusMessage msg = QDBusMessage::createMethodCall(connLogind, pathLogdMgr, ifaceLogdMgr, method);
+  QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(msg), this);
+  watcher->setProperty("type", type);
+  connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(slotListFinished(QDBusPendingCallWatcher*)));
+}
+
+void LogindSnapshot::slotListFinished(QDBusPendingCallWatcher *watcher)
+{
+  QDBusMessage reply = watcher->reply();
+  int type = watcher->property("type").toInt();
+  watcher->deleteLater();
+
+  if (reply.type() == QDBusMessage::ReplyMessage && !reply.arguments().isEmpty())
+  {
+    // ListSessions, ListUsers and ListSeats all return arrays of structs
+    // with the object path as the last member
+    const QDBusArgument arg = reply.arguments().at(0).value<QDBusArgument>();
+    if (arg.currentType() == QDBusArgument::ArrayType)
+    {
+      arg.beginArray();
+      while (!arg.atEnd())
+      {
+        QString path;
+        arg.beginStructure();
+        while (!arg.atEnd())
+        {
+          QVariant field = arg.asVariant();
+          if (field.userType() == qMetaTypeId<QDBusObjectPath>())
+            path = field.value<QDBusObjectPath>().path();
+        }
+        arg.endStructure();
+        if (!path.isEmpty())
+          batchPaths.insert(path, type);
+      }
+      arg.endArray();
+    }
+  }
+  else
+    qDebug() << "Failed to list logind objects:" << reply.errorMessage();
+
+  if (--pendingLists > 0)
+    return;
+
+  // All lists are in, pipeline the GetAll calls for every object
+  pendingGetAll = batchPaths.size();
+  if (pendingGetAll == 0)
+  {
+    commitBatch();
+    return;
+  }
+  batchQueue = batchPaths.keys();
+  sendBatch();
+}
+
+void LogindSnapshot::sendBatch()
+{
+  // The bus only allows a limited number of pending replies per connection
+  while (batchInFlight < maxInFlight && !batchQueue.isEmpty())
+  {
+    QString path = batchQueue.takeFirst();
+    ++batchInFlight;
+    fetchProperties(static_cast<logindObject>(batchPaths.value(path)), path, true);
+  }
+}
+
+void LogindSnapshot::fetchProperties(logindObject type, const QString &path, bool batch)
+{
+  QDBusMessage msg = QDBusMessage::createMethodCall(connLogind, path, ifaceDbusProp, "GetAll");
+  msg << ifaceForType.at(type);
+  QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(msg), this);
+  watcher->setProperty("path", path);
+  watcher->setProperty("batch", batch);
+  connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(slotGetAllFinished(QDBusPendingCallWatcher*)));
+}
+
+void LogindSnapshot::slotGetAllFinished(QDBusPendingCallWatcher *watcher)
+{
+  QDBusPendingReply<QVariantMap> reply = *watcher;
+  QString path = watcher->property("path").toString();
+  bool batch = watcher->property("batch").toBool();
+  watcher->deleteLater();
+
+  if (batch)
+  {
+    --batchInFlight;
+    if (reply.isError() && reply.error().name() == "org.freedesktop.DBus.Error.LimitsExceeded" &&
+        ++batchRetries[path] <= maxRetries)
+    {
+      // Asked again once other calls have finished
+      batchQueue << path;
+      sendBatch();
+      return;
+    }
+
+    // Objects that vanished in the meantime are left out of the batch.
+    // Those that failed otherwise keep their last known properties.
+    if (!reply.isError())
+      batchResults.insert(path, flattenProperties(reply.value()));
+    else if (reply.error().name() != "org.freedesktop.DBus.Error.UnknownObject")
+    {
+      qDebug() << "Failed to read logind object" << path << ":" << reply.error().message();
+      batchFailed.insert(path);
+    }
+    if (--pendingGetAll == 0)
+      commitBatch();
+    else
+      sendBatch();
+    return;
+  }
+
+  // The object may have been removed while the call was pending
+  QHash<QString, LogindEntry>::iterator it = objects.find(path);
+  if (reply.isError() || it == objects.end())
+    return;
+
+  it.value().properties = flattenProperties(reply.value());
+  emit objectChanged(it.value().type, path);
+}
+
+void LogindSnapshot::commitBatch()
+{
+  // Replace the snapshot with the results of the batch. Objects added by
+  // signals while the batch was running are kept.
+
+  foreach (const QString &path, batchStale)
+  {
+    if (!batchResults.contains(path) && !batchFailed.contains(path))
+      removeObject(path);
+  }
+
+  for (QHash<QString, QVariantMap>::const_iterator it = batchResults.constBegin(); it != batchResults.constEnd(); ++it)
+  {
+    QHash<QString, LogindEntry>::iterator entry = objects.find(it.key());
+    if (entry == objects.end())
+    {
+      LogindEntry newEntry;
+      newEntry.type = batchPaths.value(it.key());
+      newEntry.properties = it.value();
+      objects.insert(it.key(), newEntry);
+      emit objectAdded(newEntry.type, it.key());
+    }
+    else
+    {
+      entry.value().properties = it.value();
+      emit objectChanged(entry.value().type, it.key());
+    }
+  }
+
+  batchPaths.clear();
+  batchResults.clear();
+  batchStale.clear();
+  batchFailed.clear();
+  batchRetries.clear();
+  emit snapshotLoaded();
+}
+
+void LogindSnapshot::addObject(logindObject type, const QString &path)
+{
+  if (objects.contains(path))
+    return;
+
+  // The properties are filled in when GetAll returns
+  LogindEntry entry;
+  entry.type = type;
+  objects.insert(path, entry);
+  emit objectAdded(type, path);
+  fetchProperties(type, path, false);
+}
+
+void LogindSnapshot::removeObject(const QString &path)
+{
+  QHash<QString, LogindEntry>::iterator it = objects.find(path);
+  if (it == objects.end())
+    return;
+
+  int type = it.value().type;
+  objects.erase(it);
+  emit objectRemoved(type, path);
+}
+
+QVariantMap LogindSnapshot::flattenProperties(const QVariantMap &props)
+{
+  QVariantMap flat;
+  for (QVariantMap::const_iterator iter = props.constBegin(); iter != props.constEnd(); ++iter)
+    flat.insert(iter.key(), flattenValue(iter.value()));
+  return flat;
+}
+
+QVariant LogindSnapshot::flattenValue(const QVariant &value)
+{
+  // logind references other objects as (so) or (uo) structs, and lists of
+  // them as a(so). Reduce these to the id, or a list of ids, so the
+  // snapshot only holds plain values.
+
+  if (value.userType() != qMetaTypeId<QDBusArgument>())
+    return value;
+
+  const QDBusArgument arg = value.value<QDBusArgument>();
+  if (arg.currentType() == QDBusArgument::StructureType)
+  {
+    QVariant id;
+    arg.beginStructure();
+    if (!arg.atEnd())
+      id = arg.asVariant();
+    while (!arg.atEnd())
+      arg.asVariant();
+    arg.endStructure();
+    return id;
+  }
+  else if (arg.currentType() == QDBusArgument::ArrayType)
+  {
+    QStringList ids;
+    arg.beginArray();
+    while (!arg.atEnd())
+    {
+      if (arg.currentType() == QDBusArgument::StructureType)
+      {
+        arg.beginStructure();
+        if (!arg.atEnd())
+          ids << arg.asVariant().toString();
+        while (!arg.atEnd())
+          arg.asVariant();
+        arg.endStructure();
+      }
+      else
+        ids << arg.asVariant().toString();
+    }
+    arg.endArray();
+    return ids;
+  }
+
+  return QVariant();
+}
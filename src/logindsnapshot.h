@@ -0,0 +1,97 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef LOGINDSNAPSHOT_H
+#define LOGINDSNAPSHOT_H
+
+#include <QObject>
+#include <QtDBus/QtDBus>
+
+enum logindObject
+{
+  logindSession, logindUser, logindSeat
+};
+
+// Holds the properties of all logind sessions, users and seats. The initial
+// load lists all three object types and then fetches every object with one
+// pipelined batch of GetAll calls, a bounded number at a time, which is
+// committed as a whole. After that single objects are updated from the
+// logind signals.
+class LogindSnapshot : public QObject
+{
+  Q_OBJECT
+
+public:
+  LogindSnapshot(QObject *parent = 0);
+  void refresh();
+  bool contains(const QString &path) const;
+  QVariantMap properties(const QString &path) const;
+  QStringList paths(logindObject type) const;
+  void updateObject(const QString &path, const QVariantMap &changed, const QStringList &invalidated);
+  QByteArray saveState() const;
+  void restoreState(const QByteArray &state);
+
+signals:
+  void objectAdded(int type, const QString &path);
+  void objectChanged(int type, const QString &path);
+  void objectRemoved(int type, const QString &path);
+  void snapshotLoaded();
+
+public slots:
+  void slotSessionNew(QString id, QDBusObjectPath path);
+  void slotSessionRemoved(QString id, QDBusObjectPath path);
+  void slotUserNew(uint uid, QDBusObjectPath path);
+  void slotUserRemoved(uint uid, QDBusObjectPath path);
+  void slotSeatNew(QString id, QDBusObjectPath path);
+  void slotSeatRemoved(QString id, QDBusObjectPath path);
+
+private slots:
+  void slotListFinished(QDBusPendingCallWatcher *watcher);
+  void slotGetAllFinished(QDBusPendingCallWatcher *watcher);
+
+private:
+  struct LogindEntry
+  {
+    int type;
+    QVariantMap properties;
+  };
+  void listObjects(logindObject type, const QString &method);
+  void fetchProperties(logindObject type, const QString &path, bool batch);
+  void sendBatch();
+  void addObject(logindObject type, const QString &path);
+  void removeObject(const QString &path);
+  void commitBatch();
+  static QVariantMap flattenProperties(const QVariantMap &props);
+  static QVariant flattenValue(const QVariant &value);
+  QHash<QString, LogindEntry> objects;
+  QHash<QString, int> batchPaths;
+  QHash<QString, QVariantMap> batchResults;
+  QSet<QString> batchStale, batchFailed;
+  QStringList batchQueue;
+  QHash<QString, int> batchRetries;
+  int pendingLists = 0, pendingGetAll = 0, batchInFlight = 0;
+  static const int maxInFlight = 32, maxRetries = 3;
+  const QString connLogind = "org.freedesktop.login1";
+  const QString pathLogdMgr = "/org/freedesktop/login1";
+  const QString ifaceLogdMgr = "org.freedesktop.login1.Manager";
+  const QString ifaceDbusProp = "org.freedesktop.DBus.Properties";
+  const QStringList ifaceForType = QStringList() << "org.freedesktop.login1.Session"
+                                                 << "org.freedesktop.login1.User"
+                                                 << "org.freedesktop.login1.Seat";
+};
+
+#endif // LOGINDSNAPSHOT_H
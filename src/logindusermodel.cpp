@@ -0,0 +1,131 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QColor>
+#include <KLocalizedString>
+#include <KFormat>
+
+#include <boost/filesystem.hpp>
+
+#include "logindusermodel.h"
+
+LogindUserModel::LogindUserModel(LogindSnapshot *snapshot, QObject *parent)
+ : LogindModel(snapshot, logindUser, parent)
+{
+}
+
+int LogindUserModel::columnCount(const QModelIndex &) const
+{
+  return 7;
+}
+
+QVariant LogindUserModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    return QVariant();
+
+  if (section == 0)
+    return i18n("User ID");
+  else if (section == 1)
+    return i18n("User Name");
+  else if (section == 2)
+    return i18n("State");
+  else if (section == 3)
+    return i18n("Linger");
+  else if (section == 4)
+    return i18n("Runtime Directory");
+  else if (section == 5)
+    return i18n("Runtime Usage");
+  else if (section == 6)
+    return i18n("Sessions");
+  return QVariant();
+}
+
+QVariant LogindUserModel::data(const QModelIndex & index, int role) const
+{
+  if (!index.isValid() || index.row() >= rowCount())
+    return QVariant();
+
+  const QVariantMap props = propertiesAt(index.row());
+
+  if (role == Qt::DisplayRole)
+  {
+    if (index.column() == 0)
+      return props.value("UID");
+    else if (index.column() == 1)
+      return props.value("Name");
+    else if (index.column() == 2)
+      return props.value("State");
+    else if (index.column() == 3)
+    {
+      if (!props.contains("Linger"))
+        return QString("-");
+      return props.value("Linger").toBool() ? i18n("yes") : i18n("no");
+    }
+    else if (index.column() == 4)
+      return props.value("RuntimePath");
+    else if (index.column() == 5)
+    {
+      QHash<QString, qulonglong>::const_iterator it = runtimeUsage.constFind(pathAt(index.row()));
+      if (it == runtimeUsage.constEnd())
+        return QString("-");
+      return KFormat().formatByteSize(it.value());
+    }
+    else if (index.column() == 6)
+      return props.value("Sessions").toStringList().join(", ");
+  }
+
+  else if (role == Qt::ForegroundRole)
+  {
+    QColor newcolor;
+
+    if (props.value("State") == "active")
+      newcolor = Qt::darkGreen;
+    else if (props.value("State") == "closing" || props.value("State") == "lingering")
+      newcolor = Qt::darkGray;
+    else
+      newcolor = Qt::black;
+
+    return QVariant(newcolor);
+  }
+
+  return QVariant();
+}
+
+void LogindUserModel::objectUpdated(const QString &path, bool removed)
+{
+  // The runtime directory is a separate tmpfs for each user, so its usage is
+  // found from the file system size. Cache it here instead of calling
+  // statvfs every time a row is painted.
+
+  if (removed)
+  {
+    runtimeUsage.remove(path);
+    return;
+  }
+
+  QString runtimePath = logindSnapshot->properties(path).value("RuntimePath").toString();
+  if (runtimePath.isEmpty())
+    return;
+
+  boost::system::error_code ec;
+  boost::filesystem::space_info runtimePart = boost::filesystem::space(runtimePath.toStdString(), ec);
+  if (!ec)
+    runtimeUsage[path] = runtimePart.capacity - runtimePart.free;
+  else
+    runtimeUsage.remove(path);
+}
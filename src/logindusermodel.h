@@ -0,0 +1,40 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef LOGINDUSERMODEL_H
+#define LOGINDUSERMODEL_H
+
+#include "logindmodel.h"
+
+class LogindUserModel : public LogindModel
+{
+  Q_OBJECT
+
+public:
+  LogindUserModel(LogindSnapshot *snapshot, QObject *parent = 0);
+  int columnCount(const QModelIndex & parent = QModelIndex()) const;
+  QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+  QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+
+protected:
+  void objectUpdated(const QString &path, bool removed);
+
+private:
+  QHash<QString, qulonglong> runtimeUsage;
+};
+
+#endif // LOGINDUSERMODEL_H
@@ -0,0 +1,161 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <KLocalizedString>
+#include <KFormat>
+
+#include <algorithm>
+
+#include "processmodel.h"
+
+ProcessModel::ProcessModel(QObject *parent)
+ : QAbstractTableModel(parent)
+{
+}
+
+int ProcessModel::rowCount(const QModelIndex &) const
+{
+  return processes.size();
+}
+
+int ProcessModel::columnCount(const QModelIndex &) const
+{
+  return 5;
+}
+
+QVariant ProcessModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    return QVariant();
+
+  if (section == 0)
+    return i18n("PID");
+  else if (section == 1)
+    return i18n("CPU");
+  else if (section == 2)
+    return i18n("Memory");
+  else if (section == 3)
+    return i18n("Threads");
+  else if (section == 4)
+    return i18n("Command");
+  return QVariant();
+}
+
+QVariant ProcessModel::data(const QModelIndex & index, int role) const
+{
+  if (!index.isValid() || index.row() >= processes.size())
+    return QVariant();
+
+  const ProcessInfo &proc = processes.at(index.row());
+
+  if (role == Qt::DisplayRole)
+  {
+    if (index.column() == 0)
+      return proc.pid;
+    else if (index.column() == 1)
+      return QString::number(proc.cpuPermille / 10.0, 'f', 1) + " %";
+    else if (index.column() == 2)
+      return KFormat().formatByteSize(proc.rssBytes);
+    else if (index.column() == 3)
+      return proc.threads;
+    else if (index.column() == 4)
+      return proc.command;
+  }
+  else if (role == Qt::UserRole)
+  {
+    // Raw values for sorting
+    if (index.column() == 0)
+      return proc.pid;
+    else if (index.column() == 1)
+      return proc.cpuPermille;
+    else if (index.column() == 2)
+      return proc.rssBytes;
+    else if (index.column() == 3)
+      return proc.threads;
+    else if (index.column() == 4)
+      return proc.command;
+  }
+  else if (role == Qt::ToolTipRole && index.column() == 4)
+    return proc.command;
+  else if (role == Qt::TextAlignmentRole && index.column() < 4)
+    return int(Qt::AlignRight | Qt::AlignVCenter);
+
+  return QVariant();
+}
+
+void ProcessModel::slotProcessesCleared()
+{
+  beginResetModel();
+  processes.clear();
+  rowByPid.clear();
+  endResetModel();
+}
+
+void ProcessModel::slotProcessesChanged(const ProcessInfoList &changed, const QList<int> &removed)
+{
+  // Remove rows from the bottom up so the remaining rows keep their place
+  // until they are visited
+  QList<int> rows;
+  foreach (int pid, removed)
+  {
+    QHash<int, int>::const_iterator it = rowByPid.constFind(pid);
+    if (it != rowByPid.constEnd())
+      rows << it.value();
+  }
+  if (!rows.isEmpty())
+  {
+    std::sort(rows.begin(), rows.end());
+    for (int i = rows.size() - 1; i >= 0; --i)
+    {
+      beginRemoveRows(QModelIndex(), rows.at(i), rows.at(i));
+      rowByPid.remove(processes.at(rows.at(i)).pid);
+      processes.removeAt(rows.at(i));
+      endRemoveRows();
+    }
+    for (int row = rows.first(); row < processes.size(); ++row)
+      rowByPid[processes.at(row).pid] = row;
+  }
+
+  // Update known processes in place and append new ones
+  ProcessInfoList added;
+  int top = processes.size(), bottom = -1;
+  foreach (const ProcessInfo &proc, changed)
+  {
+    QHash<int, int>::const_iterator it = rowByPid.constFind(proc.pid);
+    if (it == rowByPid.constEnd())
+    {
+      added << proc;
+      continue;
+    }
+    processes[it.value()] = proc;
+    top = qMin(top, it.value());
+    bottom = qMax(bottom, it.value());
+  }
+  if (bottom >= 0)
+    emit dataChanged(index(top, 0), index(bottom, columnCount() - 1));
+
+  if (!added.isEmpty())
+  {
+    beginInsertRows(QModelIndex(), processes.size(), processes.size() + added.size() - 1);
+    foreach (const ProcessInfo &proc, added)
+    {
+      rowByPid.insert(proc.pid, processes.size());
+      processes << proc;
+    }
+    endInsertRows();
+  }
+}
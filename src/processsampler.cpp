@@ -0,0 +1,296 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QFile>
+#include <QSet>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "processsampler.h"
+#include "cgroupsampler.h"
+
+ProcessSampler::ProcessSampler(QObject *parent)
+ : QObject(parent)
+{
+  root = CgroupSampler::cgroupRoot();
+  clockTicks = sysconf(_SC_CLK_TCK);
+  pageSize = sysconf(_SC_PAGESIZE);
+  procFd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  clock.start();
+
+  // The timer is a child, so it follows the sampler to the worker thread
+  timer = new QTimer(this);
+  timer->setInterval(1000);
+  connect(timer, SIGNAL(timeout()), this, SLOT(slotSample()));
+}
+
+ProcessSampler::~ProcessSampler()
+{
+  closeCgroup();
+  if (procFd >= 0)
+    close(procFd);
+}
+
+void ProcessSampler::setCgroup(const QString &path)
+{
+  closeCgroup();
+  procs.clear();
+  scanOrder.clear();
+  newPids.clear();
+  unreadable.clear();
+  scanPos = 0;
+  emit processesCleared();
+
+  if (root.isEmpty() || path.isEmpty())
+    return;
+
+  cgroupProcsFd = open(QFile::encodeName(root + path + "/cgroup.procs").constData(), O_RDONLY | O_CLOEXEC);
+  slotSample();
+}
+
+void ProcessSampler::setInterval(int msec)
+{
+  timer->setInterval(msec);
+}
+
+void ProcessSampler::start()
+{
+  timer->start();
+}
+
+void ProcessSampler::stop()
+{
+  timer->stop();
+}
+
+void ProcessSampler::slotSample()
+{
+  if (cgroupProcsFd < 0 || procFd < 0)
+    return;
+
+  // Get the current set of PIDs
+  QByteArray data = readAll(cgroupProcsFd);
+  QSet<int> pids;
+  const char *pos = data.constData();
+  const char *end = pos + data.size();
+  while (pos < end)
+  {
+    char *next;
+    long pid = strtol(pos, &next, 10);
+    if (next == pos)
+      break;
+    pids.insert(pid);
+    pos = next;
+    while (pos < end && (*pos == '\n' || *pos == ' '))
+      ++pos;
+  }
+
+  ProcessInfoList changed;
+  QList<int> removed;
+
+  // Forget processes that have exited. Those that were never read were
+  // never reported either.
+  QHash<int, ProcessState>::iterator it = procs.begin();
+  while (it != procs.end())
+  {
+    if (!pids.contains(it.key()))
+    {
+      if (it.value().read)
+        removed << it.key();
+      it = procs.erase(it);
+    }
+    else
+      ++it;
+  }
+  if (!removed.isEmpty())
+  {
+    // Compact the scan order in one pass, keeping the round robin at
+    // the same process
+    QList<int> kept;
+    kept.reserve(scanOrder.size() - removed.size());
+    int keptBeforePos = 0;
+    for (int i = 0; i < scanOrder.size(); ++i)
+    {
+      if (!procs.contains(scanOrder.at(i)))
+        continue;
+      if (i < scanPos)
+        ++keptBeforePos;
+      kept << scanOrder.at(i);
+    }
+    scanOrder = kept;
+    scanPos = keptBeforePos;
+  }
+  unreadable.intersect(pids);
+
+  // New processes are queued, and read ahead of the round robin
+  foreach (int pid, pids)
+  {
+    if (procs.contains(pid) || unreadable.contains(pid))
+      continue;
+
+    ProcessState state;
+    state.info.pid = pid;
+    procs.insert(pid, state);
+    newPids << pid;
+  }
+
+  // Both share the budget, so a large new group is read over several
+  // samples
+  int budget = statBudget;
+  while (budget > 0 && !newPids.isEmpty())
+  {
+    int pid = newPids.takeFirst();
+    QHash<int, ProcessState>::iterator state = procs.find(pid);
+    if (state == procs.end())
+      continue;
+
+    --budget;
+    if (readStat(state.value()))
+    {
+      state.value().read = true;
+      scanOrder << pid;
+      changed << state.value().info;
+    }
+    else
+    {
+      // Not tried again while the process stays in the group
+      procs.erase(state);
+      unreadable.insert(pid);
+    }
+  }
+
+  // Continue the round robin over the known processes
+  budget = qMin(budget, scanOrder.size());
+  for (int i = 0; i < budget; ++i)
+  {
+    if (scanPos >= scanOrder.size())
+      scanPos = 0;
+    int pid = scanOrder.at(scanPos++);
+
+    ProcessState &state = procs[pid];
+    ProcessInfo before = state.info;
+    if (!readStat(state))
+      continue;
+    if (state.info.cpuPermille != before.cpuPermille ||
+        state.info.rssBytes != before.rssBytes ||
+        state.info.threads != before.threads)
+      changed << state.info;
+  }
+
+  if (!changed.isEmpty() || !removed.isEmpty())
+    emit processesChanged(changed, removed);
+}
+
+bool ProcessSampler::readStat(ProcessState &state)
+{
+  // Reads /proc/<pid>/stat. The command line is read the first time only.
+
+  char path[32];
+  snprintf(path, sizeof(path), "%d/stat", state.info.pid);
+  int fd = openat(procFd, path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  char buf[1024];
+  ssize_t r = pread(fd, buf, sizeof(buf) - 1, 0);
+  close(fd);
+  if (r <= 0)
+    return false;
+  buf[r] = '\0';
+
+  // The command name is in parentheses and may contain spaces
+  char *lparen = strchr(buf, '(');
+  char *rparen = strrchr(buf, ')');
+  if (!lparen || !rparen || rparen < lparen)
+    return false;
+
+  // Fields after the command name, starting with the state (field 3)
+  qulonglong fields[22];
+  char *pos = rparen + 2;
+  int n = 0;
+  while (n < 22 && *pos)
+  {
+    while (*pos == ' ')
+      ++pos;
+    if (n == 0)
+      fields[n] = 0;
+    else
+      fields[n] = strtoull(pos, NULL, 10);
+    while (*pos && *pos != ' ')
+      ++pos;
+    ++n;
+  }
+  if (n < 22)
+    return false;
+
+  qulonglong ticks = fields[11] + fields[12];
+  qint64 msecs = clock.elapsed();
+  if (state.lastMsecs > 0 && msecs > state.lastMsecs && ticks >= state.lastTicks)
+    state.info.cpuPermille = (ticks - state.lastTicks) * 1000 * 1000 / (clockTicks * (msecs - state.lastMsecs));
+  state.lastTicks = ticks;
+  state.lastMsecs = msecs;
+  state.info.threads = fields[17];
+  state.info.rssBytes = fields[21] * pageSize;
+
+  if (state.info.command.isEmpty())
+    state.info.command = readCommand(state.info.pid, QString::fromLocal8Bit(lparen + 1, rparen - lparen - 1));
+  return true;
+}
+
+QString ProcessSampler::readCommand(int pid, const QString &comm) const
+{
+  char path[32];
+  snprintf(path, sizeof(path), "%d/cmdline", pid);
+  int fd = openat(procFd, path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return "[" + comm + "]";
+
+  QByteArray cmdline = readAll(fd);
+  close(fd);
+
+  // Kernel threads have no command line
+  if (cmdline.isEmpty())
+    return "[" + comm + "]";
+  cmdline.replace('\0', ' ');
+  return QString::fromLocal8Bit(cmdline.trimmed());
+}
+
+QByteArray ProcessSampler::readAll(int fd) const
+{
+  // Reads a whole file from the start with pread
+  QByteArray data;
+  char buf[16384];
+  off_t offset = 0;
+  ssize_t r;
+  while ((r = pread(fd, buf, sizeof(buf), offset)) > 0)
+  {
+    data.append(buf, r);
+    offset += r;
+  }
+  return data;
+}
+
+void ProcessSampler::closeCgroup()
+{
+  if (cgroupProcsFd >= 0)
+    close(cgroupProcsFd);
+  cgroupProcsFd = -1;
+}
@@ -0,0 +1,89 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef PROCESSSAMPLER_H
+#define PROCESSSAMPLER_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+
+// A process in the control group of a unit
+struct ProcessInfo
+{
+  int pid = 0, threads = 0;
+  QString command;
+  qulonglong rssBytes = 0;
+  quint32 cpuPermille = 0;
+};
+typedef QList<ProcessInfo> ProcessInfoList;
+Q_DECLARE_METATYPE(ProcessInfo)
+Q_DECLARE_METATYPE(ProcessInfoList)
+
+// Lists the processes of one control group from cgroup.procs and reads their
+// details from /proc. It is meant to live in a worker thread. The command
+// line of a process is only read once, and at most a fixed number of
+// /proc/<pid>/stat files are read per sample, new processes first and then
+// the known ones in round robin, so large groups are covered over several
+// samples instead of stalling. Only processes that changed are reported.
+class ProcessSampler : public QObject
+{
+  Q_OBJECT
+
+public:
+  ProcessSampler(QObject *parent = 0);
+  ~ProcessSampler();
+
+public slots:
+  void setCgroup(const QString &path);
+  void setInterval(int msec);
+  void start();
+  void stop();
+
+signals:
+  void processesCleared();
+  void processesChanged(const ProcessInfoList &changed, const QList<int> &removed);
+
+private slots:
+  void slotSample();
+
+private:
+  struct ProcessState
+  {
+    ProcessInfo info;
+    qulonglong lastTicks = 0;
+    qint64 lastMsecs = 0;
+    bool read = false;
+  };
+  bool readStat(ProcessState &state);
+  QString readCommand(int pid, const QString &comm) const;
+  QByteArray readAll(int fd) const;
+  void closeCgroup();
+  QHash<int, ProcessState> procs;
+  QList<int> scanOrder, newPids;
+  QSet<int> unreadable;
+  int scanPos = 0, procFd = -1, cgroupProcsFd = -1;
+  long clockTicks, pageSize;
+  QElapsedTimer clock;
+  QTimer *timer;
+  QString root;
+  static const int statBudget = 2000;
+};
+
+#endif // PROCESSSAMPLER_H
@@ -0,0 +1,131 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <string.h>
+
+#include "resourcehistory.h"
+
+ResourceHistory::ResourceHistory(int capacity)
+{
+  cap = capacity;
+}
+
+ResourceHistory::~ResourceHistory()
+{
+  foreach (UnitHistory *history, units)
+    freeHistory(history);
+}
+
+int ResourceHistory::capacity() const
+{
+  return cap;
+}
+
+void ResourceHistory::addSamples(const CgroupSampleMap &samples, qint64 msecs)
+{
+  ++tick;
+
+  for (CgroupSampleMap::const_iterator it = samples.constBegin(); it != samples.constEnd(); ++it)
+  {
+    const CgroupSample &sample = it.value();
+    qulonglong ioBytes = sample.ioReadBytes + sample.ioWriteBytes;
+
+    QHash<QString, UnitHistory *>::iterator hit = units.find(it.key());
+    if (hit == units.end())
+    {
+      // The first sample only gives the base for the rates
+      UnitHistory *history = newHistory();
+      history->lastCpuUsec = sample.cpuUsec;
+      history->lastIoBytes = ioBytes;
+      history->lastMsecs = msecs;
+      history->lastTick = tick;
+      units.insert(it.key(), history);
+      continue;
+    }
+
+    UnitHistory *history = hit.value();
+    qint64 elapsed = msecs - history->lastMsecs;
+    if (elapsed <= 0)
+      continue;
+
+    // Counters go backwards when the unit was restarted
+    qulonglong cpu = sample.cpuUsec >= history->lastCpuUsec ? sample.cpuUsec - history->lastCpuUsec : 0;
+    qulonglong io = ioBytes >= history->lastIoBytes ? ioBytes - history->lastIoBytes : 0;
+
+    history->data[history->head] = cpu / elapsed;
+    history->data[cap + history->head] = sample.memoryBytes / 1024;
+    history->data[2 * cap + history->head] = io * 1000 / 1024 / elapsed;
+    history->head = (history->head + 1) % cap;
+    if (history->count < cap)
+      history->count++;
+
+    history->lastCpuUsec = sample.cpuUsec;
+    history->lastIoBytes = ioBytes;
+    history->lastMsecs = msecs;
+    history->lastTick = tick;
+  }
+
+  // Drop units whose whole history has expired, e.g. transient scopes
+  // that went away
+  QHash<QString, UnitHistory *>::iterator it = units.begin();
+  while (it != units.end())
+  {
+    if (tick - it.value()->lastTick > quint64(cap))
+    {
+      freeHistory(it.value());
+      it = units.erase(it);
+    }
+    else
+      ++it;
+  }
+}
+
+int ResourceHistory::values(const QString &unit, historyMetric metric, quint32 *out, int max) const
+{
+  // Copies up to max of the newest values into out, oldest first, and
+  // returns the number of values copied
+
+  QHash<QString, UnitHistory *>::const_iterator it = units.constFind(unit);
+  if (it == units.constEnd())
+    return 0;
+
+  const UnitHistory *history = it.value();
+  int n = qMin(max, history->count);
+  const quint32 *column = history->data + metric * cap;
+
+  // The values may wrap around the end of the buffer
+  int start = (history->head - n + cap) % cap;
+  int first = qMin(n, cap - start);
+  memcpy(out, column + start, first * sizeof(quint32));
+  memcpy(out + first, column, (n - first) * sizeof(quint32));
+  return n;
+}
+
+ResourceHistory::UnitHistory *ResourceHistory::newHistory()
+{
+  UnitHistory *history = new UnitHistory;
+  history->data = new quint32[3 * cap];
+  history->head = 0;
+  history->count = 0;
+  return history;
+}
+
+void ResourceHistory::freeHistory(UnitHistory *history)
+{
+  delete [] history->data;
+  delete history;
+}
@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef RESOURCEHISTORY_H
+#define RESOURCEHISTORY_H
+
+#include "cgroupsampler.h"
+
+enum historyMetric
+{
+  historyCpu, historyMemory, historyIo
+};
+
+// Fixed size history of resource usage per unit. Each unit gets one block
+// holding a ring buffer per metric, allocated when the unit is first
+// sampled and never resized. CPU is stored in permille of one CPU, memory in
+// KiB and IO in KiB/s.
+class ResourceHistory
+{
+public:
+  ResourceHistory(int capacity = 600);
+  ~ResourceHistory();
+  void addSamples(const CgroupSampleMap &samples, qint64 msecs);
+  int values(const QString &unit, historyMetric metric, quint32 *out, int max) const;
+  int capacity() const;
+
+private:
+  Q_DISABLE_COPY(ResourceHistory)
+  struct UnitHistory
+  {
+    quint32 *data;
+    int head, count;
+    qulonglong lastCpuUsec, lastIoBytes;
+    qint64 lastMsecs;
+    quint64 lastTick;
+  };
+  UnitHistory *newHistory();
+  void freeHistory(UnitHistory *history);
+  QHash<QString, UnitHistory *> units;
+  int cap;
+  quint64 tick = 0;
+};
+
+#endif // RESOURCEHISTORY_H
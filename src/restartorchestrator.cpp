@@ -0,0 +1,234 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <KAuth>
+#include <KLocalizedString>
+
+#include <algorithm>
+
+#include "restartorchestrator.h"
+
+using namespace KAuth;
+
+RestartOrchestrator::RestartOrchestrator(const QStringList &units, dbusBus bus, const QString &userBusPath,
+                                         int maxInFlight, int timeoutMsecs, QObject *parent)
+ : QObject(parent), queue(units), units(units), bus(bus), userBus(userBusPath),
+   maxInFlight(qMax(1, maxInFlight)), timeout(timeoutMsecs)
+{
+}
+
+void RestartOrchestrator::start()
+{
+  clock.start();
+  if (units.isEmpty())
+    emit finished(QStringList(), 0);
+  else
+    submitNext();
+}
+
+void RestartOrchestrator::submitNext()
+{
+  while (inFlight < maxInFlight && !queue.isEmpty())
+  {
+    // Wait for the first system call to be authorized, so the user is only
+    // asked once
+    if (bus == sys && !authorized && inFlight > 0)
+      return;
+
+    QString unit = queue.takeFirst();
+    Restart &restart = restarts[unit];
+    restart.submitted = clock.elapsed();
+    restart.timer = new QTimer(this);
+    restart.timer->setSingleShot(true);
+    restart.timer->setProperty("unit", unit);
+    connect(restart.timer, SIGNAL(timeout()), this, SLOT(slotTimeout()));
+    restart.timer->start(timeout);
+    ++inFlight;
+
+    if (bus == sys)
+    {
+      // Through the helper, which is only authorized once per session
+      QVariantMap helperArgs;
+      helperArgs["service"] = "org.freedesktop.systemd1";
+      helperArgs["path"] = "/org/freedesktop/systemd1";
+      helperArgs["interface"] = "org.freedesktop.systemd1.Manager";
+      helperArgs["method"] = "RestartUnit";
+      helperArgs["argsForCall"] = QVariantList() << unit << "replace";
+
+      Action serviceAction("org.kde.kcontrol.kcmsystemd.dbusaction");
+      serviceAction.setHelperId("org.kde.kcontrol.kcmsystemd");
+      serviceAction.setArguments(helperArgs);
+      ExecuteJob *job = serviceAction.execute();
+      job->setProperty("unit", unit);
+      connect(job, SIGNAL(result(KJob*)), this, SLOT(slotSystemSubmitted(KJob*)));
+      job->start();
+    }
+    else
+    {
+      QDBusConnection userbus = QDBusConnection::connectToBus(userBus, "org.freedesktop.systemd1");
+      QDBusMessage msg = QDBusMessage::createMethodCall("org.freedesktop.systemd1",
+                                                        "/org/freedesktop/systemd1",
+                                                        "org.freedesktop.systemd1.Manager",
+                                                        "RestartUnit");
+      msg << unit << "replace";
+      QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(userbus.asyncCall(msg), this);
+      watcher->setProperty("unit", unit);
+      connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(slotUserSubmitted(QDBusPendingCallWatcher*)));
+    }
+  }
+}
+
+void RestartOrchestrator::slotSystemSubmitted(KJob *job)
+{
+  ExecuteJob *executeJob = static_cast<ExecuteJob *>(job);
+  QString unit = job->property("unit").toString();
+  if (!job->error() && !authorized)
+  {
+    authorized = true;
+    submitNext();
+  }
+
+  if (!job->error())
+  {
+    jobSubmitted(unit, executeJob->data().value("jobPath").toString(), QString());
+    return;
+  }
+
+  QString error = job->errorText().isEmpty() ? job->errorString() : job->errorText();
+
+  // If the user cancels or is denied, the queued units are not submitted,
+  // since every one of them would ask again
+  QStringList skipped;
+  if (!authorized && (job->error() == ActionReply::AuthorizationDeniedError ||
+                      job->error() == ActionReply::UserCancelledError))
+  {
+    skipped = queue;
+    queue.clear();
+  }
+
+  jobSubmitted(unit, QString(), error);
+  foreach (const QString &skippedUnit, skipped)
+  {
+    restarts[skippedUnit].submitted = clock.elapsed();
+    settle(skippedUnit, error, clock.elapsed());
+  }
+}
+
+void RestartOrchestrator::slotUserSubmitted(QDBusPendingCallWatcher *watcher)
+{
+  QDBusPendingReply<QDBusObjectPath> reply = *watcher;
+  QString unit = watcher->property("unit").toString();
+  watcher->deleteLater();
+  if (reply.isError())
+    jobSubmitted(unit, QString(), reply.error().message());
+  else
+    jobSubmitted(unit, reply.value().path(), QString());
+}
+
+void RestartOrchestrator::jobSubmitted(const QString &unit, const QString &jobPath, const QString &error)
+{
+  Restart &restart = restarts[unit];
+  if (!restart.result.isEmpty())
+    return;
+
+  uint jobId = jobPath.section('/', -1).toUInt();
+  if (!error.isEmpty() || jobId == 0)
+  {
+    settle(unit, error.isEmpty() ? i18n("no job") : error, clock.elapsed());
+    return;
+  }
+
+  // Quick jobs may be removed before the reply arrives
+  restart.jobId = jobId;
+  if (earlyResults.contains(jobId))
+  {
+    EarlyResult early = earlyResults.take(jobId);
+    settle(unit, early.result, early.removed);
+  }
+  else
+    unitByJob.insert(jobId, unit);
+}
+
+void RestartOrchestrator::slotJobFinished(uint id, int jobBus, const QString &unit, const QString &result, qint64)
+{
+  if (jobBus != bus || !restarts.contains(unit))
+    return;
+
+  QHash<uint, QString>::iterator it = unitByJob.find(id);
+  if (it != unitByJob.end())
+  {
+    unitByJob.erase(it);
+    settle(unit, result, clock.elapsed());
+  }
+  else if (restarts.value(unit).jobId == 0 && restarts.value(unit).result.isEmpty())
+  {
+    EarlyResult early;
+    early.result = result;
+    early.removed = clock.elapsed();
+    earlyResults.insert(id, early);
+  }
+}
+
+void RestartOrchestrator::slotTimeout()
+{
+  QString unit = QObject::sender()->property("unit").toString();
+  unitByJob.remove(restarts.value(unit).jobId);
+  settle(unit, "timeout", clock.elapsed());
+}
+
+void RestartOrchestrator::settle(const QString &unit, const QString &result, qint64 removed)
+{
+  Restart &restart = restarts[unit];
+  if (!restart.result.isEmpty())
+    return;
+
+  restart.result = result;
+  restart.latency = removed - restart.submitted;
+  // Units that were never submitted have no timer
+  if (restart.timer)
+  {
+    restart.timer->deleteLater();
+    restart.timer = 0;
+    --inFlight;
+  }
+  ++settled;
+
+  if (settled < units.size())
+  {
+    submitNext();
+    return;
+  }
+
+  // All settled, slowest first
+  QList<QPair<qint64, QString> > latencies;
+  foreach (const QString &u, units)
+    latencies << qMakePair(restarts.value(u).latency, u);
+  std::sort(latencies.begin(), latencies.end());
+
+  QStringList summary;
+  int failures = 0;
+  for (int i = latencies.size() - 1; i >= 0; --i)
+  {
+    const Restart &r = restarts[latencies.at(i).second];
+    if (r.result != "done")
+      ++failures;
+    summary << QString("%1: %2 (%3 s)").arg(latencies.at(i).second)
+                                       .arg(r.result)
+                                       .arg(r.latency / 1000.0, 0, 'f', 1);
+  }
+  emit finished(summary, failures);
+}
@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef RESTARTORCHESTRATOR_H
+#define RESTARTORCHESTRATOR_H
+
+#include <QtDBus/QtDBus>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <KJob>
+
+#include "systemdunit.h"
+
+// Restarts a set of units with at most maxInFlight restart jobs running at
+// a time. A restart has settled when its job is removed, which is reported
+// to slotJobFinished() from the JobRemoved signal, or when it times out.
+// finished() carries a summary with the latency or failure of every unit.
+class RestartOrchestrator : public QObject
+{
+  Q_OBJECT
+
+public:
+  RestartOrchestrator(const QStringList &units, dbusBus bus, const QString &userBusPath,
+                      int maxInFlight, int timeoutMsecs, QObject *parent = 0);
+  void start();
+
+signals:
+  void finished(const QStringList &summary, int failures);
+
+public slots:
+  void slotJobFinished(uint id, int bus, const QString &unit, const QString &result, qint64 msecs);
+
+private slots:
+  void slotSystemSubmitted(KJob *job);
+  void slotUserSubmitted(QDBusPendingCallWatcher *watcher);
+  void slotTimeout();
+
+private:
+  struct Restart
+  {
+    qint64 submitted = -1, latency = -1;
+    uint jobId = 0;
+    QString result;
+    QTimer *timer = 0;
+  };
+  struct EarlyResult
+  {
+    QString result;
+    qint64 removed;
+  };
+  void submitNext();
+  void jobSubmitted(const QString &unit, const QString &jobPath, const QString &error);
+  void settle(const QString &unit, const QString &result, qint64 removed);
+  QStringList queue, units;
+  QHash<QString, Restart> restarts;
+  QHash<uint, QString> unitByJob;
+  QHash<uint, EarlyResult> earlyResults;
+  dbusBus bus;
+  QString userBus;
+  int maxInFlight, timeout, inFlight = 0, settled = 0;
+  bool authorized = false;
+  QElapsedTimer clock;
+};
+
+#endif // RESTARTORCHESTRATOR_H
@@ -0,0 +1,75 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <KLocalizedString>
+
+#include "seatmodel.h"
+
+SeatModel::SeatModel(LogindSnapshot *snapshot, QObject *parent)
+ : LogindModel(snapshot, logindSeat, parent)
+{
+}
+
+int SeatModel::columnCount(const QModelIndex &) const
+{
+  return 5;
+}
+
+QVariant SeatModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    return QVariant();
+
+  if (section == 0)
+    return i18n("Seat ID");
+  else if (section == 1)
+    return i18n("Active Session");
+  else if (section == 2)
+    return i18n("Graphical");
+  else if (section == 3)
+    return i18n("Text Terminal");
+  else if (section == 4)
+    return i18n("Sessions");
+  return QVariant();
+}
+
+QVariant SeatModel::data(const QModelIndex & index, int role) const
+{
+  if (!index.isValid() || index.row() >= rowCount())
+    return QVariant();
+
+  const QVariantMap props = propertiesAt(index.row());
+
+  if (role == Qt::DisplayRole)
+  {
+    if (index.column() == 0)
+      return props.value("Id");
+    else if (index.column() == 1)
+    {
+      QString active = props.value("ActiveSession").toString();
+      return active.isEmpty() ? QString("-") : active;
+    }
+    else if (index.column() == 2)
+      return props.value("CanGraphical").toBool() ? i18n("yes") : i18n("no");
+    else if (index.column() == 3)
+      return props.value("CanTTY").toBool() ? i18n("yes") : i18n("no");
+    else if (index.column() == 4)
+      return props.value("Sessions").toStringList().join(", ");
+  }
+
+  return QVariant();
+}
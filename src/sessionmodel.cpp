@@ -0,0 +1,154 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QColor>
+#include <KLocalizedString>
+
+#include "sessionmodel.h"
+
+SessionModel::SessionModel(LogindSnapshot *snapshot, QObject *parent)
+ : LogindModel(snapshot, logindSession, parent)
+{
+}
+
+int SessionModel::columnCount(const QModelIndex &) const
+{
+  return 6;
+}
+
+QVariant SessionModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    return QVariant();
+
+  if (section == 0)
+    return i18n("Session ID");
+  else if (section == 1)
+    return i18n("Session Object Path"); // This column is hidden
+  else if (section == 2)
+    return i18n("State");
+  else if (section == 3)
+    return i18n("User ID");
+  else if (section == 4)
+    return i18n("User Name");
+  else if (section == 5)
+    return i18n("Seat ID");
+  return QVariant();
+}
+
+QVariant SessionModel::data(const QModelIndex & index, int role) const
+{
+  if (!index.isValid() || index.row() >= rowCount())
+    return QVariant();
+
+  const QVariantMap props = propertiesAt(index.row());
+
+  if (role == Qt::DisplayRole)
+  {
+    if (index.column() == 0)
+      return props.value("Id");
+    else if (index.column() == 1)
+      return pathAt(index.row());
+    else if (index.column() == 2)
+      return props.value("State");
+    else if (index.column() == 3)
+      return props.value("User");
+    else if (index.column() == 4)
+      return props.value("Name");
+    else if (index.column() == 5)
+      return props.value("Seat");
+  }
+
+  else if (role == Qt::ForegroundRole)
+  {
+    // Update the text color in model
+    QColor newcolor;
+
+    if (props.value("State") == "active")
+      newcolor = Qt::darkGreen;
+    else if (props.value("State") == "closing")
+      newcolor = Qt::darkGray;
+    else
+      newcolor = Qt::black;
+
+    return QVariant(newcolor);
+  }
+
+  else if (role == Qt::ToolTipRole)
+    return buildToolTip(props);
+
+  return QVariant();
+}
+
+QString SessionModel::buildToolTip(const QVariantMap &props) const
+{
+  // Builds the tooltip from the properties cached in the logind snapshot,
+  // so no DBus calls are made here.
+
+  QString toolTipText;
+  toolTipText.append("<FONT COLOR=white>");
+  toolTipText.append("<b>" + props.value("Id").toString() + "</b><hr>");
+
+  if (props.isEmpty())
+  {
+    // Properties have not arrived yet
+    toolTipText.append(i18n("<i>Retrieving session properties...</i>"));
+    toolTipText.append("</FONT");
+    return toolTipText;
+  }
+
+  toolTipText.append(i18n("<b>VT:</b> %1", props.value("VTNr").toString()));
+
+  QString remoteHost = props.value("RemoteHost").toString();
+  if (props.value("Remote").toBool())
+  {
+    toolTipText.append(i18n("<br><b>Remote host:</b> %1", remoteHost));
+    toolTipText.append(i18n("<br><b>Remote user:</b> %1", props.value("RemoteUser").toString()));
+  }
+  toolTipText.append(i18n("<br><b>Service:</b> %1", props.value("Service").toString()));
+
+  QString type = props.value("Type").toString();
+  toolTipText.append(i18n("<br><b>Type:</b> %1", type));
+  if (type == "x11")
+    toolTipText.append(i18n(" (display %1)", props.value("Display").toString()));
+  else if (type == "tty")
+  {
+    QString path, tty = props.value("TTY").toString();
+    if (!tty.isEmpty())
+      path = tty;
+    else if (!remoteHost.isEmpty())
+      path = props.value("Name").toString() + "@" + remoteHost;
+    toolTipText.append(" (" + path + ")");
+  }
+  toolTipText.append(i18n("<br><b>Class:</b> %1", props.value("Class").toString()));
+  toolTipText.append(i18n("<br><b>State:</b> %1", props.value("State").toString()));
+  toolTipText.append(i18n("<br><b>Scope:</b> %1", props.value("Scope").toString()));
+
+  toolTipText.append(i18n("<br><b>Created: </b>"));
+  qulonglong timestamp = props.value("Timestamp").toULongLong();
+  if (timestamp == 0)
+    toolTipText.append("n/a");
+  else
+  {
+    QDateTime time;
+    time.setMSecsSinceEpoch(timestamp/1000);
+    toolTipText.append(time.toString());
+  }
+
+  toolTipText.append("</FONT");
+  return toolTipText;
+}
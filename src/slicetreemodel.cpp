@@ -0,0 +1,293 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QIcon>
+#include <KLocalizedString>
+#include <KFormat>
+
+#include "slicetreemodel.h"
+
+SliceTreeModel::SliceTreeModel(QObject *parent)
+ : QAbstractItemModel(parent)
+{
+  // The root is invisible, the top level item is the root slice
+  root = new SliceNode;
+  root->parent = NULL;
+  root->row = 0;
+  root->isSlice = true;
+  root->ownCpu = root->ownMemory = root->totalCpu = root->totalMemory = 0;
+}
+
+SliceTreeModel::~SliceTreeModel()
+{
+  qDeleteAll(nodes);
+  delete root;
+}
+
+QModelIndex SliceTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+  SliceNode *parentNode = parent.isValid() ? static_cast<SliceNode *>(parent.internalPointer()) : root;
+  if (row < 0 || row >= parentNode->children.size() || column < 0 || column >= columnCount())
+    return QModelIndex();
+  return createIndex(row, column, parentNode->children.at(row));
+}
+
+QModelIndex SliceTreeModel::parent(const QModelIndex &index) const
+{
+  if (!index.isValid())
+    return QModelIndex();
+
+  SliceNode *parentNode = static_cast<SliceNode *>(index.internalPointer())->parent;
+  if (parentNode == root || parentNode == NULL)
+    return QModelIndex();
+  return createIndex(parentNode->row, 0, parentNode);
+}
+
+int SliceTreeModel::rowCount(const QModelIndex &parent) const
+{
+  if (parent.column() > 0)
+    return 0;
+  SliceNode *parentNode = parent.isValid() ? static_cast<SliceNode *>(parent.internalPointer()) : root;
+  return parentNode->children.size();
+}
+
+int SliceTreeModel::columnCount(const QModelIndex &) const
+{
+  return 3;
+}
+
+QVariant SliceTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    return QVariant();
+
+  if (section == 0)
+    return i18n("Unit");
+  else if (section == 1)
+    return i18n("CPU time");
+  else if (section == 2)
+    return i18n("Memory");
+  return QVariant();
+}
+
+QVariant SliceTreeModel::data(const QModelIndex &index, int role) const
+{
+  if (!index.isValid())
+    return QVariant();
+
+  SliceNode *node = static_cast<SliceNode *>(index.internalPointer());
+
+  if (role == Qt::DisplayRole)
+  {
+    KFormat format;
+    if (index.column() == 0)
+      return node->id;
+    else if (index.column() == 1)
+      return format.formatDuration(node->totalCpu / 1000);
+    else if (index.column() == 2)
+      return format.formatByteSize(node->totalMemory);
+  }
+  else if (role == Qt::DecorationRole && index.column() == 0 && node->isSlice)
+    return QIcon::fromTheme("folder");
+
+  return QVariant();
+}
+
+void SliceTreeModel::setUnitSlice(const QString &unit, const QString &slice)
+{
+  // Places a service or scope under its slice, creating the slice and its
+  // parents as needed
+
+  if (slice.isEmpty())
+    return;
+
+  SliceNode *parentNode = sliceNode(slice);
+  QHash<QString, SliceNode *>::const_iterator it = nodes.constFind(unit);
+  if (it != nodes.constEnd())
+  {
+    if (it.value()->parent == parentNode)
+      return;
+    // The unit moved to another slice
+    removeUnit(unit);
+    parentNode = sliceNode(slice);
+  }
+
+  attach(newNode(unit, false), parentNode);
+}
+
+void SliceTreeModel::removeUnit(const QString &unit)
+{
+  QHash<QString, SliceNode *>::iterator it = nodes.find(unit);
+  if (it == nodes.end() || it.value()->isSlice)
+    return;
+
+  SliceNode *node = it.value();
+  nodes.erase(it);
+  detach(node);
+  delete node;
+}
+
+bool SliceTreeModel::containsUnit(const QString &unit) const
+{
+  QHash<QString, SliceNode *>::const_iterator it = nodes.constFind(unit);
+  return it != nodes.constEnd() && !it.value()->isSlice;
+}
+
+QStringList SliceTreeModel::unitIds() const
+{
+  QStringList list;
+  for (QHash<QString, SliceNode *>::const_iterator it = nodes.constBegin(); it != nodes.constEnd(); ++it)
+  {
+    if (!it.value()->isSlice)
+      list << it.key();
+  }
+  return list;
+}
+
+void SliceTreeModel::slotSamplesReady(const CgroupSampleMap &samples)
+{
+  // Apply the difference to the previous sample of each unit to the unit and
+  // all its ancestors. Changed rows are collected per parent so one
+  // dataChanged signal covers all changed siblings.
+
+  QHash<SliceNode *, QPair<int, int> > changed;
+
+  for (CgroupSampleMap::const_iterator it = samples.constBegin(); it != samples.constEnd(); ++it)
+  {
+    QHash<QString, SliceNode *>::const_iterator nodeIt = nodes.constFind(it.key());
+    if (nodeIt == nodes.constEnd() || nodeIt.value()->isSlice)
+      continue;
+
+    SliceNode *node = nodeIt.value();
+    qlonglong cpu = it.value().cpuUsec - node->ownCpu;
+    qlonglong memory = it.value().memoryBytes - node->ownMemory;
+    if (cpu == 0 && memory == 0)
+      continue;
+
+    node->ownCpu = it.value().cpuUsec;
+    node->ownMemory = it.value().memoryBytes;
+    addToAncestors(node, cpu, memory);
+
+    for (SliceNode *n = node; n != root; n = n->parent)
+    {
+      QHash<SliceNode *, QPair<int, int> >::iterator range = changed.find(n->parent);
+      if (range == changed.end())
+        changed.insert(n->parent, qMakePair(n->row, n->row));
+      else
+      {
+        range.value().first = qMin(range.value().first, n->row);
+        range.value().second = qMax(range.value().second, n->row);
+      }
+    }
+  }
+
+  for (QHash<SliceNode *, QPair<int, int> >::const_iterator it = changed.constBegin(); it != changed.constEnd(); ++it)
+  {
+    QModelIndex parentIndex = indexForNode(it.key(), 0);
+    emit dataChanged(index(it.value().first, 1, parentIndex), index(it.value().second, 2, parentIndex));
+  }
+}
+
+SliceTreeModel::SliceNode *SliceTreeModel::newNode(const QString &id, bool isSlice)
+{
+  SliceNode *node = new SliceNode;
+  node->id = id;
+  node->parent = NULL;
+  node->row = -1;
+  node->isSlice = isSlice;
+  node->ownCpu = node->ownMemory = node->totalCpu = node->totalMemory = 0;
+  nodes.insert(id, node);
+  return node;
+}
+
+SliceTreeModel::SliceNode *SliceTreeModel::sliceNode(const QString &slice)
+{
+  QHash<QString, SliceNode *>::const_iterator it = nodes.constFind(slice);
+  if (it != nodes.constEnd())
+    return it.value();
+
+  // Create the parent slices first
+  QString parentId = parentSlice(slice);
+  SliceNode *parentNode = parentId.isEmpty() ? root : sliceNode(parentId);
+  SliceNode *node = newNode(slice, true);
+  attach(node, parentNode);
+  return node;
+}
+
+QString SliceTreeModel::parentSlice(const QString &slice)
+{
+  // The slice hierarchy is encoded in the name: the parent of a-b-c.slice
+  // is a-b.slice, top level slices are children of -.slice
+  if (slice == "-.slice")
+    return QString();
+
+  QString name = slice.left(slice.length() - 6);
+  int dash = name.lastIndexOf('-');
+  if (dash <= 0)
+    return QString("-.slice");
+  return name.left(dash) + ".slice";
+}
+
+void SliceTreeModel::attach(SliceNode *node, SliceNode *parent)
+{
+  int row = parent->children.size();
+  QModelIndex parentIndex = indexForNode(parent, 0);
+  beginInsertRows(parentIndex, row, row);
+  node->parent = parent;
+  node->row = row;
+  parent->children.append(node);
+  endInsertRows();
+
+  addToAncestors(parent, node->totalCpu, node->totalMemory);
+}
+
+void SliceTreeModel::detach(SliceNode *node)
+{
+  SliceNode *parent = node->parent;
+  addToAncestors(parent, -qlonglong(node->totalCpu), -qlonglong(node->totalMemory));
+
+  beginRemoveRows(indexForNode(parent, 0), node->row, node->row);
+  parent->children.removeAt(node->row);
+  for (int i = node->row; i < parent->children.size(); ++i)
+    parent->children.at(i)->row = i;
+  node->parent = NULL;
+  endRemoveRows();
+
+  // Drop slices that became empty
+  if (parent != root && parent->children.isEmpty())
+  {
+    nodes.remove(parent->id);
+    detach(parent);
+    delete parent;
+  }
+}
+
+void SliceTreeModel::addToAncestors(SliceNode *node, qlonglong cpu, qlonglong memory)
+{
+  for (SliceNode *n = node; n != NULL; n = n->parent)
+  {
+    n->totalCpu += cpu;
+    n->totalMemory += memory;
+  }
+}
+
+QModelIndex SliceTreeModel::indexForNode(SliceNode *node, int column) const
+{
+  if (node == root || node == NULL)
+    return QModelIndex();
+  return createIndex(node->row, column, node);
+}
@@ -0,0 +1,71 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef SLICETREEMODEL_H
+#define SLICETREEMODEL_H
+
+#include <QAbstractItemModel>
+
+#include "cgroupsampler.h"
+
+// Tree of units nested under their slices. CPU time and memory are summed
+// up over each subtree. When a sample arrives, only the difference to the
+// previous sample is added to the ancestors of the unit, so the tree is
+// never walked as a whole.
+class SliceTreeModel : public QAbstractItemModel
+{
+  Q_OBJECT
+
+public:
+  SliceTreeModel(QObject *parent = 0);
+  ~SliceTreeModel();
+  QModelIndex index(int row, int column, const QModelIndex & parent = QModelIndex()) const;
+  QModelIndex parent(const QModelIndex & index) const;
+  int rowCount(const QModelIndex & parent = QModelIndex()) const;
+  int columnCount(const QModelIndex & parent = QModelIndex()) const;
+  QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+  QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+  void setUnitSlice(const QString &unit, const QString &slice);
+  void removeUnit(const QString &unit);
+  bool containsUnit(const QString &unit) const;
+  QStringList unitIds() const;
+
+public slots:
+  void slotSamplesReady(const CgroupSampleMap &samples);
+
+private:
+  struct SliceNode
+  {
+    QString id;
+    SliceNode *parent;
+    QList<SliceNode *> children;
+    int row;
+    bool isSlice;
+    qulonglong ownCpu, ownMemory, totalCpu, totalMemory;
+  };
+  SliceNode *newNode(const QString &id, bool isSlice);
+  SliceNode *sliceNode(const QString &slice);
+  static QString parentSlice(const QString &slice);
+  void attach(SliceNode *node, SliceNode *parent);
+  void detach(SliceNode *node);
+  void addToAncestors(SliceNode *node, qlonglong cpu, qlonglong memory);
+  QModelIndex indexForNode(SliceNode *node, int column) const;
+  SliceNode *root;
+  QHash<QString, SliceNode *> nodes;
+};
+
+#endif // SLICETREEMODEL_H
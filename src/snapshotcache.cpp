@@ -0,0 +1,125 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "snapshotcache.h"
+
+QDataStream &operator<<(QDataStream &stream, const SystemdUnit &unit)
+{
+  return stream << unit.id << unit.description << unit.load_state << unit.active_state
+                << unit.sub_state << unit.following << unit.unit_path.path() << unit.job_id
+                << unit.job_type << unit.job_path.path() << unit.unit_file << unit.unit_file_status;
+}
+
+QDataStream &operator>>(QDataStream &stream, SystemdUnit &unit)
+{
+  QString unitPath, jobPath;
+  stream >> unit.id >> unit.description >> unit.load_state >> unit.active_state
+         >> unit.sub_state >> unit.following >> unitPath >> unit.job_id
+         >> unit.job_type >> jobPath >> unit.unit_file >> unit.unit_file_status;
+  // Unloaded units have no object paths
+  if (!unitPath.isEmpty())
+    unit.unit_path = QDBusObjectPath(unitPath);
+  if (!jobPath.isEmpty())
+    unit.job_path = QDBusObjectPath(jobPath);
+  return stream;
+}
+
+QDataStream &operator<<(QDataStream &stream, const TimerRow &row)
+{
+  return stream << row.bus << row.timer << row.next << row.last << row.activates;
+}
+
+QDataStream &operator>>(QDataStream &stream, TimerRow &row)
+{
+  return stream >> row.bus >> row.timer >> row.next >> row.last >> row.activates;
+}
+
+QString SnapshotCache::fileName()
+{
+  return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/kcmsystemd/snapshot";
+}
+
+ModuleSnapshot SnapshotCache::load()
+{
+  ModuleSnapshot snapshot;
+
+  QFile file(fileName());
+  if (!file.open(QIODevice::ReadOnly))
+    return snapshot;
+
+  // Header: magic, version, payload size and checksum
+  const qint64 headerSize = 3 * sizeof(quint32) + sizeof(quint16);
+  if (file.size() < headerSize)
+    return snapshot;
+  uchar *mapped = file.map(0, file.size());
+  if (!mapped)
+    return snapshot;
+
+  QByteArray header = QByteArray::fromRawData((const char *)mapped, headerSize);
+  QDataStream headerStream(header);
+  quint32 magic, version, payloadSize;
+  quint16 checksum;
+  headerStream >> magic >> version >> payloadSize >> checksum;
+  if (magic != cacheMagic || version != cacheVersion || payloadSize != file.size() - headerSize)
+  {
+    file.unmap(mapped);
+    return snapshot;
+  }
+
+  const char *payload = (const char *)mapped + headerSize;
+  if (qChecksum(payload, payloadSize) != checksum)
+  {
+    qDebug() << "Ignoring snapshot with a bad checksum";
+    file.unmap(mapped);
+    return snapshot;
+  }
+
+  QByteArray data = QByteArray::fromRawData(payload, payloadSize);
+  QDataStream stream(data);
+  stream >> snapshot.systemUnits >> snapshot.userUnits >> snapshot.timers >> snapshot.logindState;
+  snapshot.valid = (stream.status() == QDataStream::Ok);
+  if (!snapshot.valid)
+    snapshot = ModuleSnapshot();
+
+  file.unmap(mapped);
+  return snapshot;
+}
+
+void SnapshotCache::save(const ModuleSnapshot &snapshot)
+{
+  QByteArray payload;
+  QDataStream stream(&payload, QIODevice::WriteOnly);
+  stream << snapshot.systemUnits << snapshot.userUnits << snapshot.timers << snapshot.logindState;
+
+  QDir().mkpath(fileName().section('/', 0, -2));
+  QSaveFile file(fileName());
+  if (!file.open(QIODevice::WriteOnly))
+    return;
+
+  QDataStream header(&file);
+  header << cacheMagic << cacheVersion << quint32(payload.size())
+         << qChecksum(payload.constData(), payload.size());
+  file.write(payload);
+  file.commit();
+}
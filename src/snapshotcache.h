@@ -0,0 +1,57 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef SNAPSHOTCACHE_H
+#define SNAPSHOTCACHE_H
+
+#include <QtDBus/QtDBus>
+
+#include "systemdunit.h"
+
+// A row of the timer list as it was shown
+struct TimerRow
+{
+  int bus = 0;
+  QString timer, next, last, activates;
+};
+
+// The lists shown by the module when it was last closed
+struct ModuleSnapshot
+{
+  QList<SystemdUnit> systemUnits, userUnits;
+  QList<TimerRow> timers;
+  QByteArray logindState;
+  bool valid = false;
+};
+
+// Keeps the last module snapshot in the user's cache directory, so the
+// lists can be painted before the managers have answered. The file has a
+// fixed header with a magic, a version, the payload size and a checksum of
+// the payload. It is mapped into memory when read, and a file that does
+// not check out is ignored.
+class SnapshotCache
+{
+public:
+  static ModuleSnapshot load();
+  static void save(const ModuleSnapshot &snapshot);
+
+private:
+  static QString fileName();
+  static const quint32 cacheMagic = 0x6b534e50, cacheVersion = 1;
+};
+
+#endif // SNAPSHOTCACHE_H
@@ -16,6 +16,7 @@
  *******************************************************************************/
 
 #include "sortfilterunitmodel.h"
+#include "unitmodel.h"
 
 SortFilterUnitModel::SortFilterUnitModel(QObject *parent)
      : QSortFilterProxyModel(parent)
@@ -30,7 +31,17 @@ void SortFilterUnitModel::initFilterMap(const QMap<filterType, QString> &map)
   {
     filtersMap[iter.key()] = iter.value();
   }
+  compileFilters();
+}
 
+void SortFilterUnitModel::compileFilters()
+{
+  // The patterns are compiled once, not for every row
+  regExps.clear();
+  for(QMap<filterType, QString>::const_iterator iter = filtersMap.constBegin(); iter != filtersMap.constEnd(); ++iter)
+  {
+    regExps[iter.key()] = QRegExp(iter.value(), iter.key() == unitName ? Qt::CaseInsensitive : Qt::CaseSensitive);
+  }
 }
 
 void SortFilterUnitModel::addFilterRegExp(filterType type, const QString &pattern)
@@ -38,29 +49,52 @@ void SortFilterUnitModel::addFilterRegExp(filterType type, const QString &patter
   if(!filtersMap.contains(type))
     return;
 
+  if (filtersMap.value(type) == pattern)
+    return;
   filtersMap[type] = pattern;
+  compileFilters();
+
+  // Rows are only added or removed, the order of the others is kept
+  invalidateFilter();
 
   // qDebug() << "filtersMap changed: " << filtersMap;
 }
 
+void SortFilterUnitModel::setUnitTypeFilter(int type)
+{
+  // Only shows units of one type, as indexed in UnitModel::typeSuffixes().
+  // 0 shows all types.
+
+  if (typeFilter == type)
+    return;
+  typeFilter = type;
+  invalidateFilter();
+}
+
 bool SortFilterUnitModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
 {
+  // The type of each unit is indexed by the model, so the type filter is
+  // a comparison of two numbers
+  if (typeFilter > 0)
+  {
+    const UnitModel *model = qobject_cast<const UnitModel *>(sourceModel());
+    if (model && model->unitType(sourceRow) != typeFilter)
+      return false;
+  }
+
   if(filtersMap.isEmpty())
     return true;
 
   bool ret = false;
 
-  for(QMap<filterType, QString>::const_iterator iter = filtersMap.constBegin(); iter != filtersMap.constEnd(); ++iter)
+  QString state = sourceModel()->index(sourceRow, 1, sourceParent).data().toString();
+  QString name = sourceModel()->index(sourceRow, 3, sourceParent).data().toString();
+  for(QMap<filterType, QRegExp>::const_iterator iter = regExps.constBegin(); iter != regExps.constEnd(); ++iter)
   {
-    QModelIndex index1 = sourceModel()->index(sourceRow, 1, sourceParent);
-    QModelIndex index3 = sourceModel()->index(sourceRow, 3, sourceParent);
-
     if (iter.key() == activeState)
-      ret = (index1.data().toString().contains(QRegExp(iter.value())));
-    else if (iter.key() == unitType)
-      ret = (index3.data().toString().contains(QRegExp(iter.value())));
-    else if (iter.key() == unitName)
-      ret = (index3.data().toString().contains(QRegExp(iter.value(), Qt::CaseInsensitive)));
+      ret = state.contains(iter.value());
+    else
+      ret = name.contains(iter.value());
 
     if(!ret)
       return ret;
@@ -68,4 +102,12 @@ bool SortFilterUnitModel::filterAcceptsRow(int sourceRow, const QModelIndex &sou
 
   return ret;
 }
- 
+
+bool SortFilterUnitModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
+{
+  // The unit columns are compared with the keys cached in the model
+  const UnitModel *model = qobject_cast<const UnitModel *>(sourceModel());
+  if (model && left.column() < 4)
+    return model->compareRows(left.row(), right.row(), left.column()) < 0;
+  return QSortFilterProxyModel::lessThan(left, right);
+}
@@ -19,10 +19,11 @@
 #define SORTFILTERUNITMODEL_H
 
 #include <QSortFilterProxyModel>
+#include <QRegExp>
 
 enum filterType
 {
-  activeState, unitType, unitName
+  activeState, unitName
 };
 
 class SortFilterUnitModel : public QSortFilterProxyModel
@@ -33,12 +34,17 @@ public:
   SortFilterUnitModel(QObject *parent = 0);
   void initFilterMap(const QMap<filterType, QString> &map);
   void addFilterRegExp(filterType type, const QString &pattern);
+  void setUnitTypeFilter(int type);
 
 protected:
   bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
+  bool lessThan(const QModelIndex &left, const QModelIndex &right) const;
 
 private:
+  void compileFilters();
   QMap<filterType, QString> filtersMap;
+  QMap<filterType, QRegExp> regExps;
+  int typeFilter = 0;
 };
 
 #endif // SORTFILTERUNITMODEL_H
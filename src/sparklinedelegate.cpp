@@ -0,0 +1,82 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QPainter>
+
+#include "sparklinedelegate.h"
+
+SparklineDelegate::SparklineDelegate(const ResourceHistory *history, QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+  resourceHistory = history;
+}
+
+void SparklineDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
+                              const QModelIndex &index) const
+{
+  // Paints the text as usual, and the history of the column's metric as a
+  // translucent sparkline on top of it
+
+  QStyledItemDelegate::paint(painter, option, index);
+
+  historyMetric metric;
+  if (index.column() == 4)
+    metric = historyCpu;
+  else if (index.column() == 5)
+    metric = historyMemory;
+  else if (index.column() == 7)
+    metric = historyIo;
+  else
+    return;
+
+  // One value per pixel at most, newest at the right edge. The buffer is
+  // on the stack, so no allocation is done while painting.
+  const int maxValues = 1024;
+  quint32 values[maxValues];
+  QRect rect = option.rect.adjusted(1, 2, -1, -2);
+  int n = resourceHistory->values(index.sibling(index.row(), 3).data().toString(),
+                                  metric, values, qMin(qMin(rect.width(), maxValues), resourceHistory->capacity()));
+  if (n < 2)
+    return;
+
+  quint32 max = 1;
+  for (int i = 0; i < n; ++i)
+    max = qMax(max, values[i]);
+
+  // CPU is scaled to at least one full CPU, so idle units stay flat
+  if (metric == historyCpu)
+    max = qMax(max, quint32(1000));
+
+  QPointF points[maxValues + 2];
+  qreal x0 = rect.right() - n + 1;
+  for (int i = 0; i < n; ++i)
+    points[i] = QPointF(x0 + i, rect.bottom() - qreal(values[i]) * rect.height() / max);
+  points[n] = QPointF(rect.right(), rect.bottom());
+  points[n + 1] = QPointF(x0, rect.bottom());
+
+  QColor color = option.palette.color(QPalette::Highlight);
+  painter->save();
+  painter->setRenderHint(QPainter::Antialiasing, false);
+  painter->setPen(Qt::NoPen);
+  color.setAlpha(60);
+  painter->setBrush(color);
+  painter->drawPolygon(points, n + 2);
+  color.setAlpha(160);
+  painter->setPen(color);
+  painter->drawPolyline(points, n);
+  painter->restore();
+}
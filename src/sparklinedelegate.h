@@ -0,0 +1,39 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef SPARKLINEDELEGATE_H
+#define SPARKLINEDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+#include "resourcehistory.h"
+
+class SparklineDelegate : public QStyledItemDelegate
+{
+  Q_OBJECT
+
+public:
+  SparklineDelegate(const ResourceHistory *history, QObject *parent = 0);
+
+  void paint(QPainter *painter, const QStyleOptionViewItem &option,
+             const QModelIndex &index) const Q_DECL_OVERRIDE;
+
+private:
+  const ResourceHistory *resourceHistory;
+};
+
+#endif // SPARKLINEDELEGATE_H
@@ -25,6 +25,8 @@ struct SystemdUnit
   }
 };
 Q_DECLARE_METATYPE(SystemdUnit)
+QDBusArgument &operator<<(QDBusArgument &argument, const SystemdUnit &unit);
+const QDBusArgument &operator>>(const QDBusArgument &argument, SystemdUnit &unit);
 
 // struct for storing sessions retrieved from logind via DBus
 struct SystemdSession
@@ -0,0 +1,93 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include "unitbatch.h"
+#include "unitfilechanges.h"
+
+UnitBatch::UnitBatch(const QDBusConnection &connection, const QString &method, const QStringList &units,
+                     int maxParallel, QObject *parent)
+ : QObject(parent), connection(connection), method(method), units(units), queue(units),
+   maxParallel(qMax(1, maxParallel))
+{
+}
+
+void UnitBatch::start()
+{
+  if (units.isEmpty())
+  {
+    done();
+    return;
+  }
+
+  if (isUnitFileMethod(method))
+  {
+    QDBusMessage msg = QDBusMessage::createMethodCall(connSystemd, pathSysdMgr, ifaceMgr, method);
+    msg << units << false;
+    if (method == "EnableUnitFiles" || method == "MaskUnitFiles")
+      msg << true;
+    queue.clear();
+    ++inFlight;
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(msg), this);
+    connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(slotCallFinished(QDBusPendingCallWatcher*)));
+  }
+  else
+    submitNext();
+}
+
+void UnitBatch::submitNext()
+{
+  while (inFlight < maxParallel && !queue.isEmpty())
+  {
+    QString unit = queue.takeFirst();
+    QDBusMessage msg = QDBusMessage::createMethodCall(connSystemd, pathSysdMgr, ifaceMgr, method);
+    msg << unit << "replace";
+    ++inFlight;
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(msg), this);
+    watcher->setProperty("unit", unit);
+    connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(slotCallFinished(QDBusPendingCallWatcher*)));
+  }
+}
+
+void UnitBatch::slotCallFinished(QDBusPendingCallWatcher *watcher)
+{
+  watcher->deleteLater();
+  --inFlight;
+  QString error = watcher->isError() ? watcher->error().message() : QString();
+
+  if (isUnitFileMethod(method))
+  {
+    foreach (const QString &unit, units)
+      results[unit] = error;
+
+    // One reload for the whole set, if anything changed
+    if (unitFileChangeCount(watcher->reply()) > 0)
+      connection.asyncCall(QDBusMessage::createMethodCall(connSystemd, pathSysdMgr, ifaceMgr, "Reload"));
+  }
+  else
+    results[watcher->property("unit").toString()] = error;
+
+  if (inFlight == 0 && queue.isEmpty())
+    done();
+  else
+    submitNext();
+}
+
+void UnitBatch::done()
+{
+  emit finished(results);
+  deleteLater();
+}
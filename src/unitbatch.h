@@ -0,0 +1,57 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef UNITBATCH_H
+#define UNITBATCH_H
+
+#include <QObject>
+#include <QtDBus/QtDBus>
+
+// Applies one Manager method to a set of units without blocking, for the
+// user bus. System units go through the batch action of the helper. The
+// unit file methods take all units in one call, jobs are submitted with at
+// most maxParallel calls in flight. finished() maps every unit to an error
+// message, which is empty on success.
+class UnitBatch : public QObject
+{
+  Q_OBJECT
+
+public:
+  UnitBatch(const QDBusConnection &connection, const QString &method, const QStringList &units,
+            int maxParallel, QObject *parent = 0);
+  void start();
+
+signals:
+  void finished(const QVariantMap &results);
+
+private slots:
+  void slotCallFinished(QDBusPendingCallWatcher *watcher);
+
+private:
+  void submitNext();
+  void done();
+  QDBusConnection connection;
+  QString method;
+  QStringList units, queue;
+  QVariantMap results;
+  int maxParallel, inFlight = 0;
+  const QString connSystemd = "org.freedesktop.systemd1";
+  const QString pathSysdMgr = "/org/freedesktop/systemd1";
+  const QString ifaceMgr = "org.freedesktop.systemd1.Manager";
+};
+
+#endif // UNITBATCH_H
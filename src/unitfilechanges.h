@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef UNITFILECHANGES_H
+#define UNITFILECHANGES_H
+
+#include <QtDBus/QtDBus>
+
+// Shared by the KCM and the helper for the Manager methods that change unit
+// files. These reply with the list of symlinks that were created or removed
+// (signature a(sss)). An empty list means nothing changed on disk, so there
+// is nothing for a daemon reload to pick up.
+
+inline bool isUnitFileMethod(const QString &method)
+{
+  return method == "EnableUnitFiles" || method == "DisableUnitFiles" ||
+         method == "MaskUnitFiles" || method == "UnmaskUnitFiles";
+}
+
+inline int unitFileChangeCount(const QDBusMessage &reply)
+{
+  if (reply.type() != QDBusMessage::ReplyMessage)
+    return 0;
+
+  foreach (const QVariant &arg, reply.arguments())
+  {
+    if (!arg.canConvert<QDBusArgument>())
+      continue;
+    const QDBusArgument dbusArg = arg.value<QDBusArgument>();
+    if (dbusArg.currentSignature() != "a(sss)")
+      continue;
+
+    int count = 0;
+    dbusArg.beginArray();
+    while (!dbusArg.atEnd())
+    {
+      QString type, file, destination;
+      dbusArg.beginStructure();
+      dbusArg >> type >> file >> destination;
+      dbusArg.endStructure();
+      ++count;
+    }
+    dbusArg.endArray();
+    return count;
+  }
+
+  // Unknown reply format, assume something changed
+  return 1;
+}
+
+#endif // UNITFILECHANGES_H
@@ -0,0 +1,171 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include "unitlistfetcher.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+
+UnitListFetcher::UnitListFetcher(const QDBusConnection &connection, dbusBus bus, QObject *parent)
+  : QObject(parent), connection(connection), bus(bus)
+{
+}
+
+QDBusMessage UnitListFetcher::call(const QString &method, const QVariantList &args)
+{
+  QDBusMessage msg = QDBusMessage::createMethodCall(connSystemd, pathSysdMgr, ifaceMgr, method);
+  msg.setArguments(args);
+  QDBusMessage reply = connection.call(msg);
+  if (reply.type() == QDBusMessage::ErrorMessage)
+    qDebug() << "DBus method call failed: " << reply.errorMessage();
+  return reply;
+}
+
+QDBusMessage UnitListFetcher::callFiltered(const QString &method, const QVariantList &args, bool *supported)
+{
+  // Remembers when the manager is too old for a filtered method, so it is
+  // only tried once
+  QDBusMessage reply = call(method, args);
+  if (reply.type() == QDBusMessage::ErrorMessage && reply.errorName() == "org.freedesktop.DBus.Error.UnknownMethod")
+  {
+    qDebug() << method << "is not supported on bus" << bus << ", filtering in the view";
+    *supported = false;
+  }
+  return reply;
+}
+
+void UnitListFetcher::setFilter(const QStringList &states, const QStringList &patterns)
+{
+  // Takes effect with the next fetch
+  filterStates = states;
+  filterPatterns = patterns;
+}
+
+QDBusMessage UnitListFetcher::listUnits()
+{
+  if (!filterPatterns.isEmpty() && hasListUnitsByPatterns)
+  {
+    QDBusMessage reply = callFiltered("ListUnitsByPatterns", QVariantList() << filterStates << filterPatterns, &hasListUnitsByPatterns);
+    if (hasListUnitsByPatterns)
+      return reply;
+  }
+  if (!filterStates.isEmpty() && hasListUnitsFiltered)
+  {
+    QDBusMessage reply = callFiltered("ListUnitsFiltered", QVariantList() << filterStates, &hasListUnitsFiltered);
+    if (hasListUnitsFiltered)
+      return reply;
+  }
+  return call("ListUnits");
+}
+
+QDBusMessage UnitListFetcher::listUnitFiles()
+{
+  if (!filterPatterns.isEmpty() && hasListUnitFilesByPatterns)
+  {
+    QDBusMessage reply = callFiltered("ListUnitFilesByPatterns", QVariantList() << QStringList() << filterPatterns, &hasListUnitFilesByPatterns);
+    if (hasListUnitFilesByPatterns)
+      return reply;
+  }
+  return call("ListUnitFiles");
+}
+
+void UnitListFetcher::subscribe()
+{
+  call("Subscribe");
+}
+
+void UnitListFetcher::fetch()
+{
+  // get an updated list of units via dbus
+
+  QElapsedTimer clock;
+  clock.start();
+  QList<SystemdUnit> list;
+  QList<unitfile> unitfileslist;
+  QDBusMessage dbusreply;
+
+  dbusreply = listUnits();
+  if (dbusreply.type() != QDBusMessage::ReplyMessage || dbusreply.arguments().isEmpty())
+  {
+    // An empty list would clear the view, keep the last one instead
+    emit fetchFailed(bus);
+    return;
+  }
+
+  const QDBusArgument argUnits = dbusreply.arguments().at(0).value<QDBusArgument>();
+  if (argUnits.currentType() == QDBusArgument::ArrayType)
+  {
+    argUnits.beginArray();
+    while (!argUnits.atEnd())
+    {
+      SystemdUnit unit;
+      argUnits >> unit;
+      list.append(unit);
+    }
+    argUnits.endArray();
+  }
+
+  // Get a list of unit files
+  dbusreply = listUnitFiles();
+  if (dbusreply.type() == QDBusMessage::ReplyMessage && !dbusreply.arguments().isEmpty())
+  {
+    const QDBusArgument argUnitFiles = dbusreply.arguments().at(0).value<QDBusArgument>();
+    argUnitFiles.beginArray();
+    while (!argUnitFiles.atEnd())
+    {
+      unitfile u;
+      argUnitFiles.beginStructure();
+      argUnitFiles >> u.name >> u.status;
+      argUnitFiles.endStructure();
+      unitfileslist.append(u);
+    }
+    argUnitFiles.endArray();
+  }
+
+  // Add unloaded units to the list
+  for (int i = 0;  i < unitfileslist.size(); ++i)
+  {
+    int index = list.indexOf(SystemdUnit(unitfileslist.at(i).name.section('/',-1)));
+    if (index > -1)
+    {
+      // The unit was already in the list, add unit file and its status
+      list[index].unit_file = unitfileslist.at(i).name;
+      list[index].unit_file_status = unitfileslist.at(i).status;
+    }
+    else if (filterStates.isEmpty())
+    {
+      // Unit not in the list, add it. Unloaded units are only listed when
+      // the states are not filtered.
+      QFile unitfile(unitfileslist.at(i).name);
+      if (unitfile.symLinkTarget().isEmpty())
+      {
+        SystemdUnit unit;
+        unit.id = unitfileslist.at(i).name.section('/',-1);
+        unit.load_state = "unloaded";
+        unit.active_state = "-";
+        unit.sub_state = "-";
+        unit.unit_file = unitfileslist.at(i).name;
+        unit.unit_file_status= unitfileslist.at(i).status;
+        list.append(unit);
+      }
+    }
+  }
+  qDebug() << "Listed" << list.size() << "units on bus" << bus << "in" << clock.elapsed() << "ms";
+
+  emit unitsFetched(list, bus);
+}
@@ -0,0 +1,75 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef UNITLISTFETCHER_H
+#define UNITLISTFETCHER_H
+
+#include <QObject>
+#include <QtDBus/QtDBus>
+
+#include "systemdunit.h"
+
+struct unitfile
+{
+  QString name, status;
+  
+  bool operator==(const unitfile& right) const
+  {
+    if (name.section('/',-1) == right.name)
+      return true;
+    else
+      return false;
+  }
+};
+
+// Lists the units and unit files of one systemd manager. Each bus gets its
+// own fetcher in its own worker thread, so the blocking calls to a slow
+// manager do not hold up the other bus or the user interface. A state and
+// name pattern filter can be passed on to the manager. Managers that do not
+// know the filtered list methods get the plain ones, and the filtering is
+// left to the view.
+class UnitListFetcher : public QObject
+{
+  Q_OBJECT
+
+public:
+  UnitListFetcher(const QDBusConnection &connection, dbusBus bus, QObject *parent = 0);
+
+public slots:
+  void subscribe();
+  void setFilter(const QStringList &states, const QStringList &patterns);
+  void fetch();
+
+signals:
+  void unitsFetched(const QList<SystemdUnit> &units, int bus);
+  void fetchFailed(int bus);
+
+private:
+  QDBusMessage call(const QString &method, const QVariantList &args = QVariantList());
+  QDBusMessage callFiltered(const QString &method, const QVariantList &args, bool *supported);
+  QDBusMessage listUnits();
+  QDBusMessage listUnitFiles();
+  QDBusConnection connection;
+  dbusBus bus;
+  QStringList filterStates, filterPatterns;
+  bool hasListUnitsFiltered = true, hasListUnitsByPatterns = true, hasListUnitFilesByPatterns = true;
+  const QString connSystemd = "org.freedesktop.systemd1";
+  const QString pathSysdMgr = "/org/freedesktop/systemd1";
+  const QString ifaceMgr = "org.freedesktop.systemd1.Manager";
+};
+
+#endif // UNITLISTFETCHER_H
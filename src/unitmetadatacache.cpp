@@ -0,0 +1,224 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QPointer>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTextStream>
+
+#include "unitmetadatacache.h"
+
+// Reads the [Unit] section of the unit files that changed since they were
+// cached. Drop-in files are not read.
+class CheckFilesTask : public QRunnable
+{
+public:
+  CheckFilesTask(UnitMetadataCache *cache, const QHash<QString, qint64> &files) : cache(cache), files(files) {}
+
+  void run()
+  {
+    UnitMetadataMap updated;
+    QStringList missing;
+    for (QHash<QString, qint64>::const_iterator it = files.constBegin(); it != files.constEnd(); ++it)
+    {
+      QFileInfo info(it.key());
+      if (!info.exists())
+      {
+        missing << it.key();
+        continue;
+      }
+      qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+      if (mtime == it.value())
+        continue;
+
+      UnitMetadata entry;
+      entry.mtime = mtime;
+      readUnitFile(it.key(), entry);
+      updated.insert(it.key(), entry);
+    }
+
+    if (cache)
+      QMetaObject::invokeMethod(cache, "slotFilesChecked", Qt::QueuedConnection,
+                                Q_ARG(UnitMetadataMap, updated), Q_ARG(QStringList, missing));
+  }
+
+private:
+  static void readUnitFile(const QString &path, UnitMetadata &entry)
+  {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+      return;
+
+    QTextStream in(&file);
+    bool unitSection = false;
+    while (!in.atEnd())
+    {
+      QString line = in.readLine().trimmed();
+      if (line.startsWith('['))
+        unitSection = (line == "[Unit]");
+      else if (!unitSection || line.startsWith('#') || line.startsWith(';'))
+        continue;
+      else if (line.startsWith("Description="))
+        entry.description = line.section('=', 1).trimmed();
+      else if (line.startsWith("Documentation="))
+      {
+        // An empty assignment resets the list
+        QString value = line.section('=', 1).trimmed();
+        if (value.isEmpty())
+          entry.documentation.clear();
+        else
+          entry.documentation << value.split(' ', QString::SkipEmptyParts);
+      }
+    }
+  }
+
+  QPointer<UnitMetadataCache> cache;
+  QHash<QString, qint64> files;
+};
+
+QDataStream &operator<<(QDataStream &stream, const UnitMetadata &entry)
+{
+  return stream << entry.mtime << entry.description << entry.documentation;
+}
+
+QDataStream &operator>>(QDataStream &stream, UnitMetadata &entry)
+{
+  return stream >> entry.mtime >> entry.description >> entry.documentation;
+}
+
+UnitMetadataCache::UnitMetadataCache(QObject *parent)
+ : QObject(parent)
+{
+  qRegisterMetaType<UnitMetadataMap>("UnitMetadataMap");
+
+  // One worker keeps the checks in order
+  pool.setMaxThreadCount(1);
+
+  // Files asked for in one go are checked in one task
+  timer = new QTimer(this);
+  timer->setSingleShot(true);
+  timer->setInterval(0);
+  connect(timer, SIGNAL(timeout()), this, SLOT(slotCheckPending()));
+
+  loadCache();
+}
+
+UnitMetadataCache::~UnitMetadataCache()
+{
+  pool.clear();
+  pool.waitForDone();
+  if (modified)
+    saveCache();
+}
+
+const UnitMetadata *UnitMetadataCache::metadata(const QString &unitFile) const
+{
+  // Returns the cached entry right away. It is checked against its file
+  // the first time it is asked for.
+
+  if (unitFile.isEmpty())
+    return NULL;
+
+  if (!checked.contains(unitFile))
+  {
+    checked.insert(unitFile);
+    pending << unitFile;
+    timer->start();
+  }
+
+  UnitMetadataMap::const_iterator it = entries.constFind(unitFile);
+  if (it == entries.constEnd())
+    return NULL;
+  return &it.value();
+}
+
+void UnitMetadataCache::slotCheckPending()
+{
+  QHash<QString, qint64> files;
+  foreach (const QString &path, pending)
+    files.insert(path, entries.value(path).mtime);
+  pending.clear();
+  if (!files.isEmpty())
+    pool.start(new CheckFilesTask(this, files));
+}
+
+void UnitMetadataCache::slotFilesChecked(const UnitMetadataMap &updated, const QStringList &missing)
+{
+  bool changed = false;
+  foreach (const QString &path, missing)
+    changed |= (entries.remove(path) > 0);
+  for (UnitMetadataMap::const_iterator it = updated.constBegin(); it != updated.constEnd(); ++it)
+  {
+    entries.insert(it.key(), it.value());
+    changed = true;
+  }
+
+  if (changed)
+  {
+    modified = true;
+    emit metadataChanged();
+  }
+}
+
+void UnitMetadataCache::slotUnitFilesChanged()
+{
+  // Check every file again when it is next asked for
+  checked.clear();
+}
+
+QString UnitMetadataCache::cacheFile() const
+{
+  return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/kcmsystemd/unitmetadata";
+}
+
+void UnitMetadataCache::loadCache()
+{
+  QFile file(cacheFile());
+  if (!file.open(QIODevice::ReadOnly))
+    return;
+
+  QDataStream stream(&file);
+  quint32 magic, version;
+  stream >> magic >> version;
+  if (magic != cacheMagic || version != cacheVersion)
+    return;
+
+  UnitMetadataMap map;
+  stream >> map;
+  if (stream.status() != QDataStream::Ok)
+    return;
+  entries = map;
+}
+
+void UnitMetadataCache::saveCache() const
+{
+  QDir().mkpath(cacheFile().section('/', 0, -2));
+  QSaveFile file(cacheFile());
+  if (!file.open(QIODevice::WriteOnly))
+    return;
+
+  QDataStream stream(&file);
+  stream << cacheMagic << cacheVersion << entries;
+  file.commit();
+}
@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef UNITMETADATACACHE_H
+#define UNITMETADATACACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+
+// What a unit file says about its unit, and when the file was modified
+struct UnitMetadata
+{
+  qint64 mtime = 0;
+  QString description;
+  QStringList documentation;
+};
+typedef QHash<QString, UnitMetadata> UnitMetadataMap;
+Q_DECLARE_METATYPE(UnitMetadata)
+Q_DECLARE_METATYPE(UnitMetadataMap)
+
+// Descriptions and documentation of units, read from their unit files and
+// kept on disk by unit file path. The cache is loaded at startup. Every
+// entry is checked against the modification time of its file the first
+// time it is asked for, and again after UnitFilesChanged. The files are
+// stat'ed and read in a worker thread, and metadataChanged() is emitted
+// when entries were updated.
+class UnitMetadataCache : public QObject
+{
+  Q_OBJECT
+
+public:
+  UnitMetadataCache(QObject *parent = 0);
+  ~UnitMetadataCache();
+  const UnitMetadata *metadata(const QString &unitFile) const;
+
+signals:
+  void metadataChanged();
+
+public slots:
+  void slotUnitFilesChanged();
+  void slotFilesChecked(const UnitMetadataMap &updated, const QStringList &missing);
+
+private slots:
+  void slotCheckPending();
+
+private:
+  QString cacheFile() const;
+  void loadCache();
+  void saveCache() const;
+  UnitMetadataMap entries;
+  mutable QSet<QString> checked;
+  mutable QStringList pending;
+  QTimer *timer;
+  QThreadPool pool;
+  bool modified = false;
+  static const quint32 cacheMagic = 0x6b554d43, cacheVersion = 1;
+};
+
+#endif // UNITMETADATACACHE_H
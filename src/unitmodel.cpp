@@ -17,7 +17,9 @@
 
 #include <QtDBus/QtDBus>
 #include <QColor>
+#include <QFont>
 #include <KLocalizedString>
+#include <KFormat>
 
 #include <systemd/sd-journal.h>
 
@@ -28,11 +30,18 @@ UnitModel::UnitModel(QObject *parent)
 {
 }
 
-UnitModel::UnitModel(QObject *parent, const QList<SystemdUnit> *list, QString userBusPath)
+UnitModel::UnitModel(QObject *parent, QList<SystemdUnit> *list, QString userBusPath)
  : QAbstractTableModel(parent)
 {
   unitList = list;
   userBus = userBusPath;
+  sampleClock.start();
+  propertyCache.setMaxCost(maxCachedUnits);
+  foreach (const SystemdUnit &unit, *unitList)
+  {
+    sortKeys << sortKey(unit);
+    countUnit(unit, 1);
+  }
 }
 
 int UnitModel::rowCount(const QModelIndex &) const
@@ -42,7 +51,7 @@ int UnitModel::rowCount(const QModelIndex &) const
 
 int UnitModel::columnCount(const QModelIndex &) const
 {
-  return 4;
+  return 10;
 }
 
 QVariant UnitModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -55,6 +64,18 @@ QVariant UnitModel::headerData(int section, Qt::Orientation orientation, int rol
     return QString("Unit state");
   if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section == 3)
     return QString("Unit");
+  if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section == 4)
+    return QString("CPU time");
+  if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section == 5)
+    return QString("Memory");
+  if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section == 6)
+    return QString("Tasks");
+  if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section == 7)
+    return QString("IO read/written");
+  if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section == 8)
+    return QString("State changed");
+  if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section == 9)
+    return QString("Description");
   return QVariant();
 }
 
@@ -74,6 +95,60 @@ QVariant UnitModel::data(const QModelIndex & index, int role) const
       return unitList->at(index.row()).sub_state;
     else if (index.column() == 3)
       return unitList->at(index.row()).id;
+    else if (index.column() == 8)
+    {
+      // Only known once the row has been visible
+      const QVariantMap *props = propertyCache.object(unitList->at(index.row()).id);
+      if (!props || props->value("StateChangeTimestamp").toULongLong() == 0)
+        return QVariant();
+      QDateTime changed;
+      changed.setMSecsSinceEpoch(props->value("StateChangeTimestamp").toULongLong() / 1000);
+      return changed.toString("yyyy.MM.dd hh:mm:ss");
+    }
+    else if (index.column() == 9)
+      return unitDescription(unitList->at(index.row()));
+    else if (index.column() >= 4)
+    {
+      // Resource usage from the last cgroup sample
+      CgroupSampleMap::const_iterator it = cgroupSamples.constFind(unitList->at(index.row()).id);
+      if (it == cgroupSamples.constEnd())
+        return QVariant();
+
+      const CgroupSample &sample = it.value();
+      KFormat format;
+      if (index.column() == 4 && sample.hasCpu)
+        return format.formatDuration(sample.cpuUsec / 1000);
+      else if (index.column() == 5 && sample.hasMemory)
+        return format.formatByteSize(sample.memoryBytes);
+      else if (index.column() == 6 && sample.hasTasks)
+        return QString::number(sample.tasks);
+      else if (index.column() == 7 && sample.hasIo)
+        return QString(format.formatByteSize(sample.ioReadBytes) + " / " + format.formatByteSize(sample.ioWriteBytes));
+    }
+  }
+
+  else if (role == Qt::UserRole)
+  {
+    // Used for sorting. The resource columns sort by their raw values.
+    if (index.column() < 4 || index.column() == 9)
+      return data(index, Qt::DisplayRole);
+    if (index.column() == 8)
+    {
+      const QVariantMap *props = propertyCache.object(unitList->at(index.row()).id);
+      return props ? props->value("StateChangeTimestamp").toULongLong() : 0ULL;
+    }
+
+    CgroupSampleMap::const_iterator it = cgroupSamples.constFind(unitList->at(index.row()).id);
+    if (it == cgroupSamples.constEnd())
+      return QVariant(0ULL);
+    if (index.column() == 4)
+      return it.value().cpuUsec;
+    else if (index.column() == 5)
+      return it.value().memoryBytes;
+    else if (index.column() == 6)
+      return it.value().tasks;
+    else if (index.column() == 7)
+      return it.value().ioReadBytes + it.value().ioWriteBytes;
   }
 
   else if (role == Qt::ForegroundRole)
@@ -93,6 +168,15 @@ QVariant UnitModel::data(const QModelIndex & index, int role) const
     return QVariant(newcolor);
   }
 
+  else if (role == Qt::FontRole && stale)
+  {
+    // Units from the last snapshot are shown in italics until the
+    // manager has answered
+    QFont font;
+    font.setItalic(true);
+    return font;
+  }
+
   else if (role == Qt::ToolTipRole)
   {
     QString selUnit = unitList->at(index.row()).id;
@@ -111,8 +195,30 @@ QVariant UnitModel::data(const QModelIndex & index, int role) const
       bus = QDBusConnection::systemBus();
     QDBusInterface *iface;
 
-    // Use the DBus interface to get unit properties
-    if (!selUnitPath.isEmpty())
+    // Use the DBus interface to get unit properties, unless they were
+    // fetched while the row was visible
+    const QVariantMap *cached = propertyCache.object(selUnit);
+    if (cached)
+    {
+      toolTipText.append(i18n("<b>Description: </b>"));
+      toolTipText.append(cached->value("Description").toString());
+      toolTipText.append(i18n("<br><b>Unit file: </b>"));
+      toolTipText.append(cached->value("FragmentPath").toString());
+      toolTipText.append(i18n("<br><b>Unit file state: </b>"));
+      toolTipText.append(cached->value("UnitFileState").toString());
+
+      const char *timestamps[] = { "ActiveEnterTimestamp", "InactiveEnterTimestamp" };
+      for (int i = 0; i < 2; ++i)
+      {
+        qulonglong usec = cached->value(timestamps[i]).toULongLong();
+        toolTipText.append(i == 0 ? i18n("<br><b>Activated: </b>") : i18n("<br><b>Deactivated: </b>"));
+        if (usec == 0)
+          toolTipText.append("n/a");
+        else
+          toolTipText.append(QDateTime::fromMSecsSinceEpoch(usec / 1000).toString());
+      }
+    }
+    else if (!selUnitPath.isEmpty())
     {
       // Unit has a valid path
 
@@ -122,13 +228,19 @@ QVariant UnitModel::data(const QModelIndex & index, int role) const
                                   bus);
       if (iface->isValid())
       {
-        // Unit has a valid unit DBus object
+        // Unit has a valid unit DBus object. Description and unit file
+        // come from the list or the unit file, only the timestamps are
+        // asked for.
+        QString description = unitDescription(unitList->at(index.row()));
         toolTipText.append(i18n("<b>Description: </b>"));
-        toolTipText.append(iface->property("Description").toString());
+        toolTipText.append(description.isEmpty() ? iface->property("Description").toString() : description);
         toolTipText.append(i18n("<br><b>Unit file: </b>"));
-        toolTipText.append(iface->property("FragmentPath").toString());
+        toolTipText.append(selUnitFile.isEmpty() ? iface->property("FragmentPath").toString() : selUnitFile);
         toolTipText.append(i18n("<br><b>Unit file state: </b>"));
-        toolTipText.append(iface->property("UnitFileState").toString());
+        if (unitList->at(index.row()).unit_file_status.isEmpty())
+          toolTipText.append(iface->property("UnitFileState").toString());
+        else
+          toolTipText.append(unitList->at(index.row()).unit_file_status);
 
         qulonglong ActiveEnterTimestamp = iface->property("ActiveEnterTimestamp").toULongLong();
         toolTipText.append(i18n("<br><b>Activated: </b>"));
@@ -178,6 +290,13 @@ QVariant UnitModel::data(const QModelIndex & index, int role) const
       delete iface;
     }
 
+    const UnitMetadata *metadata = metadataCache ? metadataCache->metadata(selUnitFile) : NULL;
+    if (metadata && !metadata->documentation.isEmpty())
+    {
+      toolTipText.append(i18n("<br><b>Documentation: </b>"));
+      toolTipText.append(metadata->documentation.join(", "));
+    }
+
     // Journal entries for units
     toolTipText.append(i18n("<hr><b>Last log entries:</b>"));
     QStringList log = getLastJrnlEntries(selUnit);
@@ -200,6 +319,327 @@ QVariant UnitModel::data(const QModelIndex & index, int role) const
   return QVariant();
 }
 
+const ResourceHistory *UnitModel::resourceHistory() const
+{
+  return &history;
+}
+
+QString UnitModel::unitDescription(const SystemdUnit &unit) const
+{
+  // Loaded units are listed with their description. For the others it
+  // is read from the unit file.
+  if (!unit.description.isEmpty() || !metadataCache)
+    return unit.description;
+  const UnitMetadata *metadata = metadataCache->metadata(unit.unit_file);
+  return metadata ? metadata->description : QString();
+}
+
+void UnitModel::setMetadataCache(const UnitMetadataCache *cache)
+{
+  metadataCache = cache;
+  connect(cache, SIGNAL(metadataChanged()), this, SLOT(slotMetadataChanged()));
+}
+
+void UnitModel::slotMetadataChanged()
+{
+  if (!unitList->isEmpty())
+    emit dataChanged(index(0, 9), index(unitList->size() - 1, 9));
+}
+
+void UnitModel::setUnit(int row, const SystemdUnit &unit)
+{
+  // Replaces a single unit, after its properties were fetched
+  countUnit(unitList->at(row), -1);
+  propertyCache.remove(unit.id);
+  (*unitList)[row] = unit;
+  countUnit(unit, 1);
+  sortKeys[row] = sortKey(unit);
+  emit dataChanged(index(row, 0), index(row, columnCount() - 1));
+  emit facetsChanged();
+}
+
+void UnitModel::countUnit(const SystemdUnit &unit, int delta)
+{
+  // Keeps the number of units per type and state up to date
+
+  QString keys[unitFacetCount];
+  keys[facetType] = "." + unit.id.section('.', -1);
+  keys[facetLoadState] = unit.load_state;
+  keys[facetActiveState] = unit.active_state;
+  for (int facet = 0; facet < unitFacetCount; ++facet)
+  {
+    int &count = facets[facet][keys[facet]];
+    count += delta;
+    if (count <= 0)
+      facets[facet].remove(keys[facet]);
+  }
+}
+
+int UnitModel::unitCount(unitFacet facet, const QString &value) const
+{
+  return facets[facet].value(value);
+}
+
+QHash<QString, int> UnitModel::unitCounts(unitFacet facet) const
+{
+  return facets[facet];
+}
+
+const SystemdUnit &UnitModel::unitAt(int row) const
+{
+  return unitList->at(row);
+}
+
+bool UnitModel::hasUnitProperties(const QString &unit) const
+{
+  return propertyCache.contains(unit);
+}
+
+void UnitModel::setUnitProperties(int row, const QString &unit, const QVariantMap &properties)
+{
+  // Caches the properties fetched for a visible unit. The least recently
+  // used units are dropped when the cache is full. The row is where the
+  // unit was when it was requested, it is looked up again if it moved.
+
+  if (row < 0 || row >= unitList->size() || unitList->at(row).id != unit)
+    row = unitList->indexOf(SystemdUnit(unit));
+  if (row == -1)
+    return;
+
+  propertyCache.insert(unit, new QVariantMap(properties));
+  emit dataChanged(index(row, 8), index(row, 8));
+}
+
+bool UnitModel::sameUnit(const SystemdUnit &a, const SystemdUnit &b)
+{
+  return a.id == b.id && a.load_state == b.load_state && a.active_state == b.active_state
+      && a.sub_state == b.sub_state && a.description == b.description && a.following == b.following
+      && a.unit_path == b.unit_path && a.job_id == b.job_id && a.job_type == b.job_type
+      && a.job_path == b.job_path && a.unit_file == b.unit_file && a.unit_file_status == b.unit_file_status;
+}
+
+static int stateRank(const QStringList &states, const QString &state)
+{
+  // Unknown states sort after the known ones
+  int rank = states.indexOf(state);
+  return rank == -1 ? states.size() : rank;
+}
+
+static const QStringList &subStates()
+{
+  // The sub states of all unit types, in alphabetical order
+  static const QStringList states = QStringList()
+    << "-" << "abandoned" << "activating" << "activating-done" << "active" << "auto-restart"
+    << "auto-restart-queued" << "cleaning" << "condition" << "dead" << "deactivating"
+    << "deactivating-sigkill" << "deactivating-sigterm" << "elapsed" << "exited" << "failed"
+    << "final-sigkill" << "final-sigterm" << "final-watchdog" << "listening" << "mounted"
+    << "mounting" << "mounting-done" << "plugged" << "reload" << "reload-notify" << "reload-signal"
+    << "remounting" << "remounting-sigkill" << "remounting-sigterm" << "running" << "start"
+    << "start-chown" << "start-post" << "start-pre" << "stop" << "stop-post" << "stop-pre"
+    << "stop-pre-sigkill" << "stop-pre-sigterm" << "stop-sigkill" << "stop-sigterm"
+    << "stop-watchdog" << "tentative" << "unmounting" << "unmounting-sigkill"
+    << "unmounting-sigterm" << "waiting";
+  return states;
+}
+
+UnitSortKey UnitModel::sortKey(const SystemdUnit &unit) const
+{
+  // The states are ranked in alphabetical order, like their names
+  static const QStringList loadStates = QStringList() << "bad-setting" << "error" << "loaded"
+                                                      << "masked" << "not-found" << "unloaded";
+  static const QStringList activeStates = QStringList() << "-" << "activating" << "active" << "deactivating"
+                                                        << "failed" << "inactive" << "maintenance" << "reloading";
+  static const QStringList types = typeSuffixes();
+  UnitSortKey key(collator.sortKey(unit.id));
+  key.loadRank = stateRank(loadStates, unit.load_state);
+  key.activeRank = stateRank(activeStates, unit.active_state);
+  key.subRank = stateRank(subStates(), unit.sub_state);
+  key.type = types.indexOf("." + unit.id.section('.', -1));
+  return key;
+}
+
+QStringList UnitModel::typeSuffixes()
+{
+  // The unit types, after an empty entry for all units
+  return QStringList() << "" << ".target" << ".service" << ".device" << ".mount"
+                       << ".automount" << ".swap" << ".socket" << ".path"
+                       << ".timer" << ".snapshot" << ".slice" << ".scope";
+}
+
+int UnitModel::unitType(int row) const
+{
+  // The index of the type in typeSuffixes(), or -1 for an unknown type
+  return sortKeys.at(row).type;
+}
+
+int UnitModel::compareRows(int left, int right, int column) const
+{
+  // Compares two rows by their cached keys. Equal states are ordered by
+  // unit name, so the order is stable while the list changes.
+
+  const UnitSortKey &l = sortKeys.at(left);
+  const UnitSortKey &r = sortKeys.at(right);
+  int result = 0;
+  if (column == 0)
+    result = l.loadRank - r.loadRank;
+  else if (column == 1)
+    result = l.activeRank - r.activeRank;
+  else if (column == 2)
+  {
+    result = l.subRank - r.subRank;
+    // Sub states that are not in the list are compared by name
+    if (result == 0 && l.subRank == subStates().size())
+      result = unitList->at(left).sub_state.compare(unitList->at(right).sub_state);
+  }
+  if (result == 0)
+    result = l.name.compare(r.name);
+  return result;
+}
+
+void UnitModel::updateUnits(const QList<SystemdUnit> &units)
+{
+  // Replaces the units with a new list. Units are matched by id and only
+  // the rows that were removed, changed or added are signalled, so
+  // selections and proxy mappings survive. Remaining rows keep their
+  // place and new units are appended.
+
+  QHash<QString, int> newRows;
+  newRows.reserve(units.size());
+  for (int i = 0; i < units.size(); ++i)
+    newRows.insert(units.at(i).id, i);
+
+  // Remove the units that are gone, in runs from the bottom up
+  bool modified = false;
+  int row = unitList->size() - 1;
+  while (row >= 0)
+  {
+    if (newRows.contains(unitList->at(row).id))
+    {
+      --row;
+      continue;
+    }
+    int last = row;
+    while (row > 0 && !newRows.contains(unitList->at(row - 1).id))
+      --row;
+    beginRemoveRows(QModelIndex(), row, last);
+    for (int i = row; i <= last; ++i)
+    {
+      countUnit(unitList->at(i), -1);
+      propertyCache.remove(unitList->at(i).id);
+    }
+    unitList->erase(unitList->begin() + row, unitList->begin() + last + 1);
+    sortKeys.erase(sortKeys.begin() + row, sortKeys.begin() + last + 1);
+    endRemoveRows();
+    modified = true;
+    --row;
+  }
+
+  // Update the units that changed, signalled in runs of adjacent rows
+  QVector<bool> known(units.size(), false);
+  int firstChanged = -1;
+  for (row = 0; row < unitList->size(); ++row)
+  {
+    int newRow = newRows.value(unitList->at(row).id);
+    known[newRow] = true;
+    bool changed = !sameUnit(unitList->at(row), units.at(newRow));
+    if (changed)
+    {
+      countUnit(unitList->at(row), -1);
+      countUnit(units.at(newRow), 1);
+      propertyCache.remove(unitList->at(row).id);
+      (*unitList)[row] = units.at(newRow);
+      sortKeys[row] = sortKey(units.at(newRow));
+      modified = true;
+      if (firstChanged == -1)
+        firstChanged = row;
+    }
+    else if (firstChanged != -1)
+    {
+      emit dataChanged(index(firstChanged, 0), index(row - 1, columnCount() - 1));
+      firstChanged = -1;
+    }
+  }
+  if (firstChanged != -1)
+    emit dataChanged(index(firstChanged, 0), index(unitList->size() - 1, columnCount() - 1));
+
+  // Append the new units
+  QList<SystemdUnit> added;
+  for (int i = 0; i < units.size(); ++i)
+  {
+    if (!known.at(i))
+      added << units.at(i);
+  }
+  if (!added.isEmpty())
+  {
+    beginInsertRows(QModelIndex(), unitList->size(), unitList->size() + added.size() - 1);
+    unitList->append(added);
+    foreach (const SystemdUnit &unit, added)
+    {
+      sortKeys << sortKey(unit);
+      countUnit(unit, 1);
+    }
+    endInsertRows();
+    modified = true;
+  }
+  if (modified)
+    emit facetsChanged();
+}
+
+void UnitModel::setStale(bool value)
+{
+  if (stale == value)
+    return;
+  stale = value;
+  if (rowCount() > 0)
+    emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
+}
+
+bool UnitModel::isStale() const
+{
+  return stale;
+}
+
+void UnitModel::slotSamplesReady(const CgroupSampleMap &samples)
+{
+  CgroupSampleMap previous = cgroupSamples;
+  cgroupSamples = samples;
+  history.addSamples(samples, sampleClock.elapsed());
+
+  // Only the resource columns (4-7) of rows whose sample changed are
+  // reported, in runs of rows, so the proxy does not filter every row
+  // again on every sample
+  int first = -1;
+  for (int row = 0; row <= unitList->size(); ++row)
+  {
+    bool changed = false;
+    if (row < unitList->size())
+    {
+      const QString &id = unitList->at(row).id;
+      CgroupSampleMap::const_iterator before = previous.constFind(id);
+      CgroupSampleMap::const_iterator after = samples.constFind(id);
+      if ((before == previous.constEnd()) != (after == samples.constEnd()))
+        changed = true;
+      else if (after != samples.constEnd())
+        changed = !sameSample(before.value(), after.value());
+    }
+
+    if (changed && first == -1)
+      first = row;
+    else if (!changed && first != -1)
+    {
+      emit dataChanged(index(first, 4), index(row - 1, 7));
+      first = -1;
+    }
+  }
+}
+
+bool UnitModel::sameSample(const CgroupSample &a, const CgroupSample &b)
+{
+  return a.cpuUsec == b.cpuUsec && a.memoryBytes == b.memoryBytes && a.tasks == b.tasks &&
+         a.ioReadBytes == b.ioReadBytes && a.ioWriteBytes == b.ioWriteBytes &&
+         a.hasCpu == b.hasCpu && a.hasMemory == b.hasMemory && a.hasTasks == b.hasTasks && a.hasIo == b.hasIo;
+}
+
 QStringList UnitModel::getLastJrnlEntries(QString unit) const
 {
   QString match1, match2;
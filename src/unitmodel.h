@@ -19,8 +19,27 @@
 #define UNITMODEL_H
 
 #include <QAbstractTableModel>
+#include <QCache>
+#include <QCollator>
+#include <QElapsedTimer>
 
 #include "systemdunit.h"
+#include "cgroupsampler.h"
+#include "resourcehistory.h"
+#include "unitmetadatacache.h"
+
+enum unitFacet
+{
+  facetType, facetLoadState, facetActiveState, unitFacetCount
+};
+
+// Sort keys of a unit, computed when the unit is added or changed
+struct UnitSortKey
+{
+  UnitSortKey(const QCollatorSortKey &name) : name(name) {}
+  QCollatorSortKey name;
+  int loadRank = 0, activeRank = 0, subRank = 0, type = -1;
+};
 
 class UnitModel : public QAbstractTableModel
 {
@@ -28,16 +47,52 @@ class UnitModel : public QAbstractTableModel
   
 public:
   UnitModel(QObject *parent = 0);
-  UnitModel(QObject *parent = 0, const QList<SystemdUnit> *list = NULL, QString userBusPath = "");
+  UnitModel(QObject *parent = 0, QList<SystemdUnit> *list = NULL, QString userBusPath = "");
   int rowCount(const QModelIndex & parent = QModelIndex()) const;
   int columnCount(const QModelIndex & parent = QModelIndex()) const;
   QVariant headerData(int section, Qt::Orientation orientation, int role) const;
   QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+  const ResourceHistory *resourceHistory() const;
+  void setUnit(int row, const SystemdUnit &unit);
+  void updateUnits(const QList<SystemdUnit> &units);
+  int compareRows(int left, int right, int column) const;
+  int unitType(int row) const;
+  const SystemdUnit &unitAt(int row) const;
+  bool hasUnitProperties(const QString &unit) const;
+  void setUnitProperties(int row, const QString &unit, const QVariantMap &properties);
+  static QStringList typeSuffixes();
+  int unitCount(unitFacet facet, const QString &value) const;
+  QHash<QString, int> unitCounts(unitFacet facet) const;
+  void setMetadataCache(const UnitMetadataCache *cache);
+  void setStale(bool stale);
+  bool isStale() const;
+
+signals:
+  void facetsChanged();
+
+public slots:
+  void slotSamplesReady(const CgroupSampleMap &samples);
+  void slotMetadataChanged();
 
 private:
   QStringList getLastJrnlEntries(QString unit) const;
-  const QList<SystemdUnit> *unitList;
+  static bool sameUnit(const SystemdUnit &a, const SystemdUnit &b);
+  static bool sameSample(const CgroupSample &a, const CgroupSample &b);
+  QString unitDescription(const SystemdUnit &unit) const;
+  UnitSortKey sortKey(const SystemdUnit &unit) const;
+  void countUnit(const SystemdUnit &unit, int delta);
+  QList<SystemdUnit> *unitList;
+  QList<UnitSortKey> sortKeys;
+  QHash<QString, int> facets[unitFacetCount];
+  QCache<QString, QVariantMap> propertyCache;
+  static const int maxCachedUnits = 2000;
+  const UnitMetadataCache *metadataCache = NULL;
+  QCollator collator;
   QString userBus;
+  CgroupSampleMap cgroupSamples;
+  ResourceHistory history;
+  QElapsedTimer sampleClock;
+  bool stale = false;
 };
   
 #endif // UNITMODEL_H
@@ -0,0 +1,127 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QAbstractProxyModel>
+#include <QScrollBar>
+
+#include "unitprefetcher.h"
+
+UnitPrefetcher::UnitPrefetcher(QTableView *view, UnitModel *model, const QDBusConnection &connection, QObject *parent)
+  : QObject(parent), view(view), model(model), connection(connection)
+{
+  timer = new QTimer(this);
+  timer->setSingleShot(true);
+  connect(timer, SIGNAL(timeout()), this, SLOT(slotUpdateQueue()));
+
+  scrollClock.start();
+  connect(view->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(slotScrolled(int)));
+
+  // Rows coming, going or moving change what is visible
+  QAbstractItemModel *viewModel = view->model();
+  connect(viewModel, SIGNAL(layoutChanged()), this, SLOT(slotSchedule()));
+  connect(viewModel, SIGNAL(rowsInserted(QModelIndex, int, int)), this, SLOT(slotSchedule()));
+  connect(viewModel, SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(slotSchedule()));
+  connect(viewModel, SIGNAL(modelReset()), this, SLOT(slotSchedule()));
+
+  // Changed units are dropped from the cache and fetched again
+  connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(slotSchedule()));
+}
+
+void UnitPrefetcher::slotScrolled(int value)
+{
+  // Rows per second, measured between two scroll steps
+  qint64 msecs = qMax<qint64>(scrollClock.restart(), 1);
+  scrollSpeed = qAbs(value - lastScrollValue) * 1000.0 / msecs;
+  lastScrollValue = value;
+  slotSchedule();
+}
+
+void UnitPrefetcher::slotSchedule()
+{
+  // Wait until the view has come to rest
+  timer->start(scrollSpeed > fastScroll ? scrollingDelay : idleDelay);
+}
+
+void UnitPrefetcher::slotUpdateQueue()
+{
+  scrollSpeed = 0;
+
+  QAbstractItemModel *viewModel = view->model();
+  QAbstractProxyModel *proxy = qobject_cast<QAbstractProxyModel *>(viewModel);
+  if (!proxy || viewModel->rowCount() == 0)
+  {
+    queue.clear();
+    return;
+  }
+
+  int first = view->rowAt(0);
+  int last = view->rowAt(view->viewport()->height() - 1);
+  if (first == -1)
+    first = 0;
+  if (last == -1)
+    last = viewModel->rowCount() - 1;
+  int margin = (last - first + 1) / 2;
+  first = qMax(0, first - margin);
+  last = qMin(viewModel->rowCount() - 1, last + margin);
+
+  // The new queue replaces the old one, which drops the units that have
+  // scrolled out
+  queue.clear();
+  for (int row = first; row <= last; ++row)
+  {
+    int sourceRow = proxy->mapToSource(viewModel->index(row, 0)).row();
+    if (sourceRow == -1)
+      continue;
+    const SystemdUnit &unit = model->unitAt(sourceRow);
+    if (unit.unit_path.path().isEmpty() || inFlight.contains(unit.id) || model->hasUnitProperties(unit.id))
+      continue;
+    queue << qMakePair(sourceRow, unit.id);
+  }
+  sendNext();
+}
+
+void UnitPrefetcher::sendNext()
+{
+  while (inFlight.size() < maxInFlight && !queue.isEmpty())
+  {
+    QPair<int, QString> next = queue.takeFirst();
+    int row = next.first;
+    if (row >= model->rowCount() || model->unitAt(row).id != next.second)
+      continue;
+
+    QDBusMessage msg = QDBusMessage::createMethodCall(connSystemd, model->unitAt(row).unit_path.path(), ifaceDbusProp, "GetAll");
+    msg << ifaceUnit;
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(msg), this);
+    watcher->setProperty("row", row);
+    watcher->setProperty("unit", next.second);
+    connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(slotPropertiesFetched(QDBusPendingCallWatcher*)));
+    inFlight.insert(next.second);
+  }
+}
+
+void UnitPrefetcher::slotPropertiesFetched(QDBusPendingCallWatcher *watcher)
+{
+  QDBusPendingReply<QVariantMap> reply = *watcher;
+  QString unit = watcher->property("unit").toString();
+  int row = watcher->property("row").toInt();
+  watcher->deleteLater();
+
+  inFlight.remove(unit);
+  if (!reply.isError())
+    model->setUnitProperties(row, unit, reply.value());
+  sendNext();
+}
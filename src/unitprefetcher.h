@@ -0,0 +1,66 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef UNITPREFETCHER_H
+#define UNITPREFETCHER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTableView>
+#include <QTimer>
+#include <QtDBus/QtDBus>
+
+#include "unitmodel.h"
+
+// Fetches the unit properties behind the extra columns and the tooltips,
+// only for the rows that are visible in a view, plus half a page on either
+// side. The visible range is checked when the view scrolls or its rows
+// change. While the view scrolls fast nothing is requested, and units that
+// scroll out before their call was sent are dropped from the queue. Only a
+// few calls are in flight at a time. The results are kept in the bounded
+// cache of the model.
+class UnitPrefetcher : public QObject
+{
+  Q_OBJECT
+
+public:
+  UnitPrefetcher(QTableView *view, UnitModel *model, const QDBusConnection &connection, QObject *parent = 0);
+
+private slots:
+  void slotScrolled(int value);
+  void slotSchedule();
+  void slotUpdateQueue();
+  void slotPropertiesFetched(QDBusPendingCallWatcher *watcher);
+
+private:
+  void sendNext();
+  QTableView *view;
+  UnitModel *model;
+  QDBusConnection connection;
+  QTimer *timer;
+  QElapsedTimer scrollClock;
+  int lastScrollValue = 0;
+  double scrollSpeed = 0;
+  QList<QPair<int, QString> > queue;
+  QSet<QString> inFlight;
+  static const int maxInFlight = 8, idleDelay = 50, scrollingDelay = 250, fastScroll = 50;
+  const QString connSystemd = "org.freedesktop.systemd1";
+  const QString ifaceUnit = "org.freedesktop.systemd1.Unit";
+  const QString ifaceDbusProp = "org.freedesktop.DBus.Properties";
+};
+
+#endif // UNITPREFETCHER_H
@@ -0,0 +1,289 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#include <QColor>
+#include <QDateTime>
+
+#include "unitpropertymodel.h"
+
+UnitPropertyModel::UnitPropertyModel(const QDBusConnection &connection, QObject *parent)
+  : QAbstractTableModel(parent), connection(connection)
+{
+  clock.start();
+  fadeTimer = new QTimer(this);
+  fadeTimer->setInterval(1000);
+  connect(fadeTimer, SIGNAL(timeout()), this, SLOT(slotFadeHighlights()));
+}
+
+int UnitPropertyModel::rowCount(const QModelIndex &) const
+{
+  return properties.size();
+}
+
+int UnitPropertyModel::columnCount(const QModelIndex &) const
+{
+  return 3;
+}
+
+QVariant UnitPropertyModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section == 0)
+    return QString("Interface");
+  if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section == 1)
+    return QString("Property");
+  if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section == 2)
+    return QString("Value");
+  return QVariant();
+}
+
+QVariant UnitPropertyModel::data(const QModelIndex & index, int role) const
+{
+  if (!index.isValid())
+    return QVariant();
+
+  const UnitProperty &property = properties.at(index.row());
+  if (role == Qt::DisplayRole)
+  {
+    if (index.column() == 0)
+      return property.interface.section('.', -1);
+    else if (index.column() == 1)
+      return property.name;
+    else if (index.column() == 2)
+      return property.value;
+  }
+  else if (role == Qt::ToolTipRole && index.column() == 2)
+    return property.value;
+  else if (role == Qt::BackgroundRole && property.changedAt != -1)
+    return QColor(255, 240, 150);
+
+  return QVariant();
+}
+
+void UnitPropertyModel::setUnit(const QString &unit, const QString &path)
+{
+  // Replaces the rows with the properties of another unit. Replies that
+  // are still on their way from an earlier selection are ignored, even
+  // when the same unit is selected again.
+
+  beginResetModel();
+  properties.clear();
+  rowByKey.clear();
+  interfaces.clear();
+  unitPath = path;
+  ++generation;
+  endResetModel();
+  fadeTimer->stop();
+
+  if (path.isEmpty())
+    return;
+
+  // Every unit type has its own interface, named after the suffix
+  QString type = unit.section('.', -1);
+  QStringList ifaces = QStringList() << ifaceUnit;
+  if (!type.isEmpty())
+    ifaces << QString(connSystemd + "." + type.left(1).toUpper() + type.mid(1));
+
+  foreach (const QString &iface, ifaces)
+  {
+    QDBusMessage msg = QDBusMessage::createMethodCall(connSystemd, path, ifaceDbusProp, "GetAll");
+    msg << iface;
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(msg), this);
+    watcher->setProperty("generation", generation);
+    watcher->setProperty("interface", iface);
+    connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(slotPropertiesFetched(QDBusPendingCallWatcher*)));
+  }
+}
+
+void UnitPropertyModel::slotPropertiesFetched(QDBusPendingCallWatcher *watcher)
+{
+  QDBusPendingReply<QVariantMap> reply = *watcher;
+  int gen = watcher->property("generation").toInt();
+  QString iface = watcher->property("interface").toString();
+  watcher->deleteLater();
+
+  if (gen != generation || reply.isError() || reply.value().isEmpty())
+    return;
+
+  // Loaded rows are not highlighted
+  QVariantMap values = reply.value();
+  beginInsertRows(QModelIndex(), properties.size(), properties.size() + values.size() - 1);
+  for (QVariantMap::const_iterator it = values.constBegin(); it != values.constEnd(); ++it)
+  {
+    UnitProperty property;
+    property.interface = iface;
+    property.name = it.key();
+    property.value = formatValue(it.key(), it.value());
+    rowByKey.insert(iface + "/" + it.key(), properties.size());
+    properties << property;
+  }
+  endInsertRows();
+  interfaces.insert(iface);
+}
+
+void UnitPropertyModel::updateProperties(const QString &path, const QString &interface, const QVariantMap &changed, const QStringList &invalidated)
+{
+  // Applies a PropertiesChanged signal. Properties that are only reported
+  // as invalidated are asked for one by one.
+
+  if (path != unitPath || !interfaces.contains(interface))
+    return;
+
+  for (QVariantMap::const_iterator it = changed.constBegin(); it != changed.constEnd(); ++it)
+    storeProperty(interface, it.key(), it.value());
+
+  foreach (const QString &name, invalidated)
+  {
+    QDBusMessage msg = QDBusMessage::createMethodCall(connSystemd, path, ifaceDbusProp, "Get");
+    msg << interface << name;
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(msg), this);
+    watcher->setProperty("generation", generation);
+    watcher->setProperty("interface", interface);
+    watcher->setProperty("name", name);
+    connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(slotPropertyFetched(QDBusPendingCallWatcher*)));
+  }
+}
+
+void UnitPropertyModel::slotPropertyFetched(QDBusPendingCallWatcher *watcher)
+{
+  QDBusPendingReply<QDBusVariant> reply = *watcher;
+  watcher->deleteLater();
+  if (watcher->property("generation").toInt() != generation || reply.isError())
+    return;
+  storeProperty(watcher->property("interface").toString(), watcher->property("name").toString(), reply.value().variant());
+}
+
+void UnitPropertyModel::storeProperty(const QString &interface, const QString &name, const QVariant &value)
+{
+  QString text = formatValue(name, value);
+  QHash<QString, int>::const_iterator it = rowByKey.constFind(interface + "/" + name);
+  if (it == rowByKey.constEnd())
+  {
+    UnitProperty property;
+    property.interface = interface;
+    property.name = name;
+    property.value = text;
+    property.changedAt = clock.elapsed();
+    beginInsertRows(QModelIndex(), properties.size(), properties.size());
+    rowByKey.insert(interface + "/" + name, properties.size());
+    properties << property;
+    endInsertRows();
+  }
+  else
+  {
+    UnitProperty &property = properties[it.value()];
+    if (property.value == text)
+      return;
+    property.value = text;
+    property.changedAt = clock.elapsed();
+    emit dataChanged(index(it.value(), 0), index(it.value(), columnCount() - 1));
+  }
+
+  if (!fadeTimer->isActive())
+    fadeTimer->start();
+}
+
+void UnitPropertyModel::slotFadeHighlights()
+{
+  bool highlighted = false;
+  qint64 now = clock.elapsed();
+  for (int row = 0; row < properties.size(); ++row)
+  {
+    UnitProperty &property = properties[row];
+    if (property.changedAt == -1)
+      continue;
+    if (now - property.changedAt < highlightMsecs)
+    {
+      highlighted = true;
+      continue;
+    }
+    property.changedAt = -1;
+    emit dataChanged(index(row, 0), index(row, columnCount() - 1));
+  }
+
+  if (!highlighted)
+    fadeTimer->stop();
+}
+
+QString UnitPropertyModel::formatValue(const QString &name, const QVariant &value)
+{
+  // Arrays, structures and dictionaries arrive as QDBusArgument
+
+  if (value.userType() == qMetaTypeId<QDBusArgument>())
+    return formatArgument(value.value<QDBusArgument>());
+  else if (value.userType() == qMetaTypeId<QDBusVariant>())
+    return formatValue(name, value.value<QDBusVariant>().variant());
+  else if (value.userType() == qMetaTypeId<QDBusObjectPath>())
+    return value.value<QDBusObjectPath>().path();
+  else if (value.userType() == qMetaTypeId<QDBusSignature>())
+    return value.value<QDBusSignature>().signature();
+  else if (value.type() == QVariant::StringList)
+    return value.toStringList().join(", ");
+  else if (value.type() == QVariant::ByteArray)
+    return QString(value.toByteArray().toHex());
+  else if (name.endsWith("Timestamp") && value.canConvert<qulonglong>())
+  {
+    qulonglong usec = value.toULongLong();
+    if (usec == 0)
+      return QString("n/a");
+    return QDateTime::fromMSecsSinceEpoch(usec / 1000).toString("yyyy.MM.dd hh:mm:ss");
+  }
+  return value.toString();
+}
+
+QString UnitPropertyModel::formatArgument(const QDBusArgument &arg)
+{
+  QStringList items;
+  switch (arg.currentType())
+  {
+    case QDBusArgument::BasicType:
+      return formatValue(QString(), arg.asVariant());
+
+    case QDBusArgument::VariantType:
+      return formatValue(QString(), arg.asVariant().value<QDBusVariant>().variant());
+
+    case QDBusArgument::ArrayType:
+      arg.beginArray();
+      while (!arg.atEnd())
+        items << formatArgument(arg);
+      arg.endArray();
+      return "[" + items.join(", ") + "]";
+
+    case QDBusArgument::StructureType:
+      arg.beginStructure();
+      while (!arg.atEnd())
+        items << formatArgument(arg);
+      arg.endStructure();
+      return "(" + items.join(", ") + ")";
+
+    case QDBusArgument::MapType:
+    {
+      arg.beginMap();
+      while (!arg.atEnd())
+      {
+        arg.beginMapEntry();
+        QString key = formatArgument(arg);
+        items << QString(key + ": " + formatArgument(arg));
+        arg.endMapEntry();
+      }
+      arg.endMap();
+      return "{" + items.join(", ") + "}";
+    }
+
+    default:
+      return QString();
+  }
+}
@@ -0,0 +1,73 @@
+/*******************************************************************************
+ * Copyright (C) 2013-2015 Ragnar Thomsen <rthomsen6@gmail.com>                *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify it     *
+ * under the terms of the GNU General Public License as published by the Free  *
+ * Software Foundation, either version 3 of the License, or (at your option)   *
+ * any later version.                                                          *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful, but WITHOUT *
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details.                                                               *
+ *                                                                             *
+ * You should have received a copy of the GNU General Public License along     *
+ * with this program. If not, see <http://www.gnu.org/licenses/>.              *
+ *******************************************************************************/
+
+#ifndef UNITPROPERTYMODEL_H
+#define UNITPROPERTYMODEL_H
+
+#include <QAbstractTableModel>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QtDBus/QtDBus>
+
+struct UnitProperty
+{
+  QString interface, name, value;
+  qint64 changedAt = -1;
+};
+
+// All properties of the selected unit, on the Unit interface and on the
+// interface of its type. Each interface is loaded with one GetAll when the
+// unit is selected. After that the rows are only updated from the
+// PropertiesChanged signals for the unit's object path, and the rows that
+// changed are highlighted for a few seconds.
+class UnitPropertyModel : public QAbstractTableModel
+{
+  Q_OBJECT
+
+public:
+  UnitPropertyModel(const QDBusConnection &connection, QObject *parent = 0);
+  int rowCount(const QModelIndex & parent = QModelIndex()) const;
+  int columnCount(const QModelIndex & parent = QModelIndex()) const;
+  QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+  QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+  void setUnit(const QString &unit, const QString &path);
+  void updateProperties(const QString &path, const QString &interface, const QVariantMap &changed, const QStringList &invalidated);
+
+private slots:
+  void slotPropertiesFetched(QDBusPendingCallWatcher *watcher);
+  void slotPropertyFetched(QDBusPendingCallWatcher *watcher);
+  void slotFadeHighlights();
+
+private:
+  void storeProperty(const QString &interface, const QString &name, const QVariant &value);
+  static QString formatValue(const QString &name, const QVariant &value);
+  static QString formatArgument(const QDBusArgument &arg);
+  QDBusConnection connection;
+  QString unitPath;
+  QList<UnitProperty> properties;
+  QHash<QString, int> rowByKey;
+  QSet<QString> interfaces;
+  QTimer *fadeTimer;
+  QElapsedTimer clock;
+  int generation = 0;
+  static const int highlightMsecs = 5000;
+  const QString connSystemd = "org.freedesktop.systemd1";
+  const QString ifaceUnit = "org.freedesktop.systemd1.Unit";
+  const QString ifaceDbusProp = "org.freedesktop.DBus.Properties";
+};
+
+#endif // UNITPROPERTYMODEL_H